@@ -0,0 +1,266 @@
+#include "Analytics.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <limits>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+const double INF = numeric_limits<double>::infinity();
+
+void sum_min_max(const double *a, size_t n, double &sum, double &mn, double &mx) {
+    size_t i = 0;
+    sum = 0; mn = INF; mx = -INF;
+#ifdef __SSE2__
+    // Two accumulators of two lanes each, so adds from consecutive loads overlap.
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    __m128d lo = _mm_set1_pd(INF), hi = _mm_set1_pd(-INF);
+    for (; i + 4 <= n; i += 4) {
+        __m128d x0 = _mm_loadu_pd(a + i), x1 = _mm_loadu_pd(a + i + 2);
+        s0 = _mm_add_pd(s0, x0);
+        s1 = _mm_add_pd(s1, x1);
+        lo = _mm_min_pd(lo, _mm_min_pd(x0, x1));
+        hi = _mm_max_pd(hi, _mm_max_pd(x0, x1));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1)); sum = t[0] + t[1];
+    _mm_storeu_pd(t, lo); mn = min(t[0], t[1]);
+    _mm_storeu_pd(t, hi); mx = max(t[0], t[1]);
+#endif
+    for (; i < n; ++i) {
+        sum += a[i];
+        mn = min(mn, a[i]);
+        mx = max(mx, a[i]);
+    }
+}
+
+// Sum of squared deviations from mean (second pass, numerically stable).
+double sum_sq_dev(const double *a, size_t n, double mean) {
+    size_t i = 0;
+    double sum = 0;
+#ifdef __SSE2__
+    __m128d m = _mm_set1_pd(mean), s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), m), d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), m);
+        s0 = _mm_add_pd(s0, _mm_mul_pd(d0, d0));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(d1, d1));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    sum = t[0] + t[1];
+#endif
+    for (; i < n; ++i) sum += (a[i] - mean) * (a[i] - mean);
+    return sum;
+}
+
+// Dense group id for every student; names receives the groups sorted, so
+// ids follow name order. Chunks label their students with local ids, which
+// are then remapped.
+vector<uint32_t> group_ids(const vector<Student> &students, GroupBy by, vector<string> &names, ThreadPool &pool) {
+    vector<uint32_t> ids(students.size(), 0);
+    names.assign(1, "");
+    if (by == GroupBy::None) return ids;
+    auto label = [&](const Student &s) { return by == GroupBy::Branch ? s.get_branch() : to_string(s.get_startYear()); };
+
+    size_t chunks = students.size() < 65536 ? 1 : pool.concurrency() * 4;
+    vector<vector<string>> local(chunks);
+    {
+        TaskGroup g(pool);
+        for (size_t c = 0; c < chunks; ++c) {
+            g.run([&, c]() {
+                unordered_map<string, uint32_t> seen;
+                for (size_t i = students.size() * c / chunks; i < students.size() * (c + 1) / chunks; ++i) {
+                    auto it = seen.try_emplace(label(students[i]), (uint32_t)seen.size()).first;
+                    if (it->second == local[c].size()) local[c].push_back(it->first);
+                    ids[i] = it->second;
+                }
+            });
+        }
+    }
+    names.clear();
+    for (auto &l : local) names.insert(names.end(), l.begin(), l.end());
+    sort(names.begin(), names.end());
+    names.erase(unique(names.begin(), names.end()), names.end());
+
+    TaskGroup g(pool);
+    for (size_t c = 0; c < chunks; ++c) {
+        g.run([&, c]() {
+            vector<uint32_t> remap;
+            for (auto &n : local[c]) remap.push_back((uint32_t)(lower_bound(names.begin(), names.end(), n) - names.begin()));
+            for (size_t i = students.size() * c / chunks; i < students.size() * (c + 1) / chunks; ++i) ids[i] = remap[ids[i]];
+        });
+    }
+    g.wait();
+    return ids;
+}
+
+// All grades laid out column by column: column col = group * courses + course
+// occupies values[start[col], start[col + 1]).
+struct Columns {
+    size_t courses = 0;
+    vector<string> groups;
+    vector<size_t> start;
+    vector<double> values;
+};
+
+vector<CourseStats> summarize_columns(Columns &cols, ThreadPool &pool) {
+    vector<size_t> order;
+    for (size_t col = 0; col + 1 < cols.start.size(); ++col)
+        if (cols.start[col + 1] > cols.start[col]) order.push_back(col);
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const string &na = CourseDict::name((CourseKey)(a % cols.courses)), &nb = CourseDict::name((CourseKey)(b % cols.courses));
+        return na != nb ? na < nb : a < b;
+    });
+
+    vector<CourseStats> out(order.size());
+    TaskGroup g(pool);
+    for (size_t i = 0; i < order.size(); ++i) {
+        g.run([&, i]() {
+            size_t col = order[i];
+            out[i].course = (CourseKey)(col % cols.courses);
+            out[i].group = cols.groups[col / cols.courses];
+            out[i].stats = Analytics::summarize(cols.values.data() + cols.start[col], cols.start[col + 1] - cols.start[col]);
+        });
+    }
+    g.wait();
+    return out;
+}
+
+// Turns per-column counts into column start offsets and sizes the value array.
+void layout(Columns &cols, const vector<size_t> &count) {
+    cols.start.assign(count.size() + 1, 0);
+    for (size_t col = 0; col < count.size(); ++col) cols.start[col + 1] = cols.start[col] + count[col];
+    cols.values.resize(cols.start.back());
+}
+}
+
+GradeStats Analytics::summarize(double *a, size_t n) {
+    GradeStats s;
+    s.count = n;
+    if (n == 0) return s;
+    double sum;
+    sum_min_max(a, n, sum, s.min, s.max);
+    s.mean = sum / n;
+    s.variance = sum_sq_dev(a, n, s.mean) / n;
+    for (size_t i = 0; i < n; ++i) {
+        int b = (int)(a[i] * 2);
+        s.hist[b < 0 ? 0 : b >= GradeStats::BINS ? GradeStats::BINS - 1 : b]++;
+    }
+    // Columns read from a CourseIndex arrive sorted by grade (descending), so
+    // percentiles are a lookup; otherwise select them in ascending rank order,
+    // each selection only looking right of the previous one.
+    const double pct[] = {25, 50, 75, 90, 99};
+    double *out[] = {&s.p25, &s.p50, &s.p75, &s.p90, &s.p99};
+    bool desc = is_sorted(a, a + n, greater<double>());
+    size_t from = 0;
+    for (int k = 0; k < 5; ++k) {
+        size_t rank = max<size_t>(1, (size_t)ceil(pct[k] / 100.0 * n));
+        if (desc) { *out[k] = a[n - rank]; continue; }
+        nth_element(a + from, a + rank - 1, a + n);
+        *out[k] = a[rank - 1];
+        from = rank - 1;
+    }
+    return s;
+}
+
+vector<CourseStats> Analytics::course_stats(const vector<Student> &students, GroupBy by, unsigned threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    ThreadPool pool(threads - 1);
+    Columns cols;
+    cols.courses = CourseDict::size();
+    vector<uint32_t> gid = group_ids(students, by, cols.groups, pool);
+    size_t ncols = cols.groups.size() * cols.courses;
+
+    // Count per (chunk, column), then every chunk fills its own disjoint slots.
+    size_t chunks = students.size() < 65536 ? 1 : pool.concurrency() * 4;
+    auto range = [&](size_t c) { return make_pair(students.size() * c / chunks, students.size() * (c + 1) / chunks); };
+    vector<vector<size_t>> cnt(chunks, vector<size_t>(ncols, 0));
+    {
+        TaskGroup g(pool);
+        for (size_t c = 0; c < chunks; ++c) {
+            g.run([&, c]() {
+                auto [b, e] = range(c);
+                for (size_t i = b; i < e; ++i)
+                    for_each_unique_course(students[i], [&](const CourseEntry &p) { cnt[c][gid[i] * cols.courses + p.first]++; });
+            });
+        }
+    }
+    vector<size_t> total(ncols, 0);
+    for (auto &cc : cnt) for (size_t col = 0; col < ncols; ++col) total[col] += cc[col];
+    layout(cols, total);
+    {
+        vector<size_t> next(cols.start.begin(), cols.start.end() - 1);
+        for (auto &cc : cnt) for (size_t col = 0; col < ncols; ++col) { size_t n = cc[col]; cc[col] = next[col]; next[col] += n; }
+        TaskGroup g(pool);
+        for (size_t c = 0; c < chunks; ++c) {
+            g.run([&, c]() {
+                auto [b, e] = range(c);
+                for (size_t i = b; i < e; ++i)
+                    for_each_unique_course(students[i], [&](const CourseEntry &p) { cols.values[cnt[c][gid[i] * cols.courses + p.first]++] = p.second; });
+            });
+        }
+    }
+    return summarize_columns(cols, pool);
+}
+
+vector<CourseStats> Analytics::course_stats(const CourseIndex &idx, const vector<Student> &students, GroupBy by, unsigned threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    ThreadPool pool(threads - 1);
+    Columns cols;
+    cols.courses = CourseDict::size();
+    vector<uint32_t> gid = group_ids(students, by, cols.groups, pool);
+    size_t ncols = cols.groups.size() * cols.courses;
+
+    // A course's postings only touch that course's columns, so courses run in parallel.
+    vector<pair<const Posting*, const Posting*>> lists(cols.courses);
+    for (CourseKey k = 0; k < cols.courses; ++k) lists[k] = idx.grade_range(CourseDict::lookup(k), -INF, INF);
+    vector<size_t> count(ncols, 0);
+    {
+        TaskGroup g(pool);
+        for (CourseKey k = 0; k < cols.courses; ++k)
+            g.run([&, k]() { for (auto *p = lists[k].first; p != lists[k].second; ++p) count[gid[p->student] * cols.courses + k]++; });
+    }
+    layout(cols, count);
+    {
+        vector<size_t> next(cols.start.begin(), cols.start.end() - 1);
+        TaskGroup g(pool);
+        for (CourseKey k = 0; k < cols.courses; ++k)
+            g.run([&, k]() { for (auto *p = lists[k].first; p != lists[k].second; ++p) cols.values[next[gid[p->student] * cols.courses + k]++] = p->grade; });
+    }
+    return summarize_columns(cols, pool);
+}
+
+string Analytics::to_text(const vector<CourseStats> &stats) {
+    stringstream ss;
+    ss << left << setw(10) << "course" << setw(8) << "group" << right << setw(9) << "count";
+    for (const char *h : {"mean", "std", "min", "p25", "p50", "p75", "p90", "p99", "max"}) ss << setw(7) << h;
+    ss << "\n" << fixed << setprecision(2);
+    for (auto &c : stats) {
+        const GradeStats &s = c.stats;
+        ss << left << setw(10) << CourseDict::name(c.course) << setw(8) << (c.group.empty() ? "all" : c.group)
+           << right << setw(9) << s.count;
+        for (double v : {s.mean, sqrt(s.variance), s.min, s.p25, s.p50, s.p75, s.p90, s.p99, s.max}) ss << setw(7) << v;
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+string Analytics::histogram_text(const CourseStats &c) {
+    stringstream ss;
+    uint32_t peak = *max_element(c.stats.hist, c.stats.hist + GradeStats::BINS);
+    ss << CourseDict::name(c.course) << (c.group.empty() ? "" : " / " + c.group) << "\n" << fixed << setprecision(1);
+    for (int b = 0; b < GradeStats::BINS; ++b) {
+        if (c.stats.hist[b] == 0) continue;
+        int bar = peak ? (int)(40.0 * c.stats.hist[b] / peak + 0.5) : 0;
+        ss << "  " << setw(4) << b * 0.5 << "-" << setw(4) << (b + 1) * 0.5 << " | " << string(bar, '#') << " " << c.stats.hist[b] << "\n";
+    }
+    return ss.str();
+}
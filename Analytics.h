@@ -0,0 +1,45 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include "CourseIndex.h"
+#include <vector>
+#include <string>
+
+enum class GroupBy { None, Branch, StartYear };
+
+// Summary of one grade column. Variance is the population variance;
+// percentiles are exact (nearest rank). hist[i] counts grades in
+// [i * 0.5, (i + 1) * 0.5), with 10.0 falling in the last bin.
+struct GradeStats {
+    static const int BINS = 20;
+    size_t count = 0;
+    double mean = 0, variance = 0, min = 0, max = 0;
+    double p25 = 0, p50 = 0, p75 = 0, p90 = 0, p99 = 0;
+    uint32_t hist[BINS] = {};
+};
+
+// Stats of one course, overall (group empty) or for one branch / start year.
+struct CourseStats {
+    CourseKey course;
+    string group;
+    GradeStats stats;
+};
+
+// Per-course grade statistics. Grades are first laid out as one contiguous
+// array per (course, group) column, so each column is reduced with SSE2 when
+// available, and the columns are summarised in parallel on a ThreadPool.
+// A student counts once per course, with the grade CourseIndex would index.
+// Results are ordered by course name, then group.
+namespace Analytics {
+    vector<CourseStats> course_stats(const vector<Student> &students, GroupBy by = GroupBy::None, unsigned threads = 0);
+    // Same, reading the columns from a built index instead of the student records.
+    vector<CourseStats> course_stats(const CourseIndex &idx, const vector<Student> &students,
+                                     GroupBy by = GroupBy::None, unsigned threads = 0);
+    // Summarises grades[0, n); reorders the array.
+    GradeStats summarize(double *grades, size_t n);
+
+    string to_text(const vector<CourseStats> &stats);
+    string histogram_text(const CourseStats &s);
+}
+
+#endif
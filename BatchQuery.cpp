@@ -0,0 +1,109 @@
+#include "BatchQuery.h"
+#include "ERPUtils.h"
+#include "InputValidator.h" // for trim
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+namespace {
+struct Query {
+    size_t line;
+    CourseID course;
+    string courseText, thresholdText;
+    Grade threshold;
+};
+
+const size_t BLOCK = 64; // queries per task
+
+bool parse_query(const string &raw, size_t line, Query &q) {
+    auto comma = raw.find(',');
+    if (comma == string::npos) return false;
+    q.line = line;
+    q.courseText = InputValidator::trim(raw.substr(0, comma));
+    q.thresholdText = InputValidator::trim(raw.substr(comma + 1));
+    if (q.courseText.empty() || q.thresholdText.empty()) return false;
+    char *end = nullptr;
+    q.threshold = strtod(q.thresholdText.c_str(), &end);
+    if (*end != '\0') return false;
+    q.course = ERPUtils::parse_course_id(q.courseText);
+    return true;
+}
+
+// Formats the hits of queries [begin, end) into out; returns the number of rows.
+size_t answer_block(const CourseIndex &idx, const vector<Student> &students,
+                    const Query *begin, const Query *end, string &out) {
+    size_t rows = 0;
+    char buf[64];
+    for (const Query *q = begin; q != end; ++q) {
+        string prefix = to_string(q->line) + "," + q->courseText + "," + q->thresholdText + ",";
+        for (const Posting &p : idx.top_students_for_course(q->course, q->threshold)) {
+            out += prefix;
+            char rb[24];
+            out += roll_view(students[p.student].get_roll(), rb);
+            int n = snprintf(buf, sizeof(buf), ",%.1f\n", p.grade);
+            out.append(buf, n);
+            ++rows;
+        }
+    }
+    return rows;
+}
+}
+
+BatchStats ERPUtils::run_batch_queries(const CourseIndex &idx, const vector<Student> &students,
+                                       istream &in, ostream &out, unsigned threads) {
+    auto st = chrono::steady_clock::now();
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    ThreadPool pool(threads - 1);
+    BatchStats stats;
+    out << "query,course,threshold,roll,grade\n";
+
+    // Queries are read a window at a time, so memory stays bounded however
+    // long the file is; each window is split into blocks answered in parallel
+    // and the block outputs are written back in order.
+    const size_t window = BLOCK * threads * 4;
+    vector<Query> queries;
+    string raw;
+    size_t line = 0;
+    bool more = true;
+    while (more) {
+        queries.clear();
+        while (queries.size() < window && (more = (bool)getline(in, raw))) {
+            ++line;
+            string t = InputValidator::trim(raw);
+            if (t.empty() || t[0] == '#') continue;
+            Query q;
+            if (parse_query(t, line, q)) queries.push_back(move(q));
+            else {
+                cerr << "batch: skipping malformed query on line " << line << ": " << raw << "\n";
+                ++stats.rejected;
+            }
+        }
+        if (queries.empty()) continue;
+
+        size_t blocks = (queries.size() + BLOCK - 1) / BLOCK;
+        vector<string> parts(blocks);
+        vector<size_t> rows(blocks, 0);
+        {
+            TaskGroup g(pool);
+            for (size_t b = 0; b < blocks; ++b) {
+                g.run([&, b]() {
+                    const Query *first = queries.data() + b * BLOCK;
+                    const Query *last = queries.data() + min(queries.size(), (b + 1) * BLOCK);
+                    rows[b] = answer_block(idx, students, first, last, parts[b]);
+                });
+            }
+            g.wait();
+        }
+        for (size_t b = 0; b < blocks; ++b) {
+            out.write(parts[b].data(), parts[b].size());
+            stats.results += rows[b];
+        }
+        stats.queries += queries.size();
+    }
+    out.flush();
+    stats.duration_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - st).count();
+    return stats;
+}
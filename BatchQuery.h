@@ -0,0 +1,26 @@
+#ifndef BATCHQUERY_H
+#define BATCHQUERY_H
+
+#include "CourseIndex.h"
+#include <iostream>
+
+// Totals of one batch run: queries answered, malformed lines skipped,
+// result rows written and wall time.
+struct BatchStats {
+    size_t queries = 0;
+    size_t rejected = 0;
+    size_t results = 0;
+    long long duration_us = 0;
+};
+
+namespace ERPUtils {
+    // Reads `course,threshold` lines from in (blank lines and # comments are
+    // skipped), answers them against idx on `threads` threads (0 = hardware_concurrency)
+    // and writes CSV to out in query order, one row per matching student:
+    //   query,course,threshold,roll,grade
+    // where query is the 1-based line number in the query file.
+    BatchStats run_batch_queries(const CourseIndex &idx, const vector<Student> &students,
+                                 istream &in, ostream &out, unsigned threads = 0);
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include "BlockReader.h"
+#include "Metrics.h"
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using clk = chrono::steady_clock;
+
+static long long micros_since(clk::time_point t) {
+    return chrono::duration_cast<chrono::microseconds>(clk::now() - t).count();
+}
+
+bool BlockReader::open(const string &filename, const Options &opt) {
+    close();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size <= 0) { ::close(fd); fd = -1; return false; }
+    fileSize = (size_t)sb.st_size;
+    blockBytes = (max<size_t>(opt.block_bytes, page) + page - 1) / page * page;
+
+    bool direct = opt.direct > 0;
+    if (opt.direct < 0) direct = fileSize > (size_t)sysconf(_SC_PHYS_PAGES) * page / 2;
+    // O_DIRECT is refused by some filesystems (e.g. tmpfs); those use the page cache.
+    st = Stats();
+    if (direct && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_DIRECT) == 0) st.direct = true;
+    else posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    size_t depth = max<size_t>(opt.depth, 2);
+    for (size_t i = 0; i < depth; ++i) {
+        char *buf = static_cast<char*>(aligned_alloc(page, blockBytes));
+        if (!buf) { close(); return false; }
+        buffers.push_back(buf);
+        freeList.push_back((int)i);
+    }
+    finished = cancelled = failed = false;
+    reader = thread(&BlockReader::read_loop, this);
+    return true;
+}
+
+// Fills buf from offset up to a whole block or the end of the file; a short
+// count before the end means a read error.
+size_t BlockReader::read_full(char *buf, size_t offset) {
+    size_t got = 0;
+    while (got < blockBytes && offset + got < fileSize) {
+        ssize_t r = pread(fd, buf + got, blockBytes - got, (off_t)(offset + got));
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && errno == EINVAL && st.direct) {
+            // Alignment rules the open did not catch: drop O_DIRECT and retry.
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+            st.direct = false;
+            continue;
+        }
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    return got;
+}
+
+void BlockReader::read_loop() {
+    string pending; // unfinished record at the end of the previous buffer
+    size_t pendingOffset = 0, offset = 0, seq = 0, bytes = 0;
+    bool err = false;
+    auto publish = [&](Block &&b) {
+        lock_guard<mutex> lk(m);
+        b.seq = seq++;
+        ready.push_back(move(b));
+        st.blocks++;
+        hasReady.notify_one();
+    };
+
+    while (offset < fileSize) {
+        int id;
+        {
+            unique_lock<mutex> lk(m);
+            auto t0 = clk::now();
+            hasFree.wait(lk, [&]() { return cancelled || !freeList.empty(); });
+            st.reader_wait_us += micros_since(t0);
+            if (cancelled) break;
+            id = freeList.back();
+            freeList.pop_back();
+        }
+        char *buf = buffers[id];
+        size_t n = read_full(buf, offset);
+        bytes += n;
+        bool last = offset + n >= fileSize || n < blockBytes;
+        if (offset + n < fileSize && n < blockBytes) err = true;
+
+        Block b;
+        b.buffer = id;
+        const char *begin = buf, *end = buf + n;
+        if (!pending.empty()) {
+            const char *nl = static_cast<const char*>(memchr(buf, '\n', n));
+            const char *stop = nl ? nl : end;
+            pending.append(buf, stop - buf);
+            begin = nl ? nl + 1 : end;
+            if (nl || last) {
+                b.lead = move(pending);
+                b.lead_offset = pendingOffset;
+                pending.clear();
+            }
+        }
+        // Hold back the unfinished last record; it continues in the next buffer.
+        if (!last && begin < end) {
+            const char *nl = static_cast<const char*>(memrchr(begin, '\n', end - begin));
+            const char *cut = nl ? nl + 1 : begin;
+            if (cut < end) {
+                if (pending.empty()) pendingOffset = offset + (cut - buf);
+                pending.append(cut, end - cut);
+            }
+            end = cut;
+        }
+        b.data = begin;
+        b.size = end - begin;
+        b.offset = offset + (begin - buf);
+        offset += n;
+
+        if (b.size == 0 && b.lead.empty()) {
+            lock_guard<mutex> lk(m);
+            freeList.push_back(id);
+        } else {
+            publish(move(b));
+        }
+        if (last) break;
+    }
+    // A read error can leave a record without its end; deliver what was read.
+    if (!pending.empty() && !err) {
+        Block b;
+        b.lead = move(pending);
+        b.lead_offset = pendingOffset;
+        publish(move(b));
+    }
+    Metrics::add(Counter::BytesRead, bytes);
+    lock_guard<mutex> lk(m);
+    st.bytes = bytes;
+    failed = err;
+    finished = true;
+    hasReady.notify_all();
+}
+
+bool BlockReader::next(Block &b) {
+    unique_lock<mutex> lk(m);
+    auto t0 = clk::now();
+    hasReady.wait(lk, [&]() { return cancelled || finished || !ready.empty(); });
+    st.consumer_wait_us += micros_since(t0);
+    if (cancelled || ready.empty()) return false;
+    b = move(ready.front());
+    ready.pop_front();
+    return true;
+}
+
+void BlockReader::release(Block &b) {
+    if (b.buffer < 0) return;
+    lock_guard<mutex> lk(m);
+    freeList.push_back(b.buffer);
+    b.buffer = -1;
+    b.data = nullptr;
+    hasFree.notify_one();
+}
+
+void BlockReader::cancel() {
+    lock_guard<mutex> lk(m);
+    cancelled = true;
+    hasFree.notify_all();
+    hasReady.notify_all();
+}
+
+void BlockReader::close() {
+    if (reader.joinable()) {
+        cancel();
+        reader.join();
+    }
+    for (char *buf : buffers) free(buf);
+    buffers.clear();
+    freeList.clear();
+    ready.clear();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
@@ -0,0 +1,86 @@
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+using namespace std;
+
+// Read stage of the load pipeline. A background thread reads the file into
+// a fixed ring of page-aligned buffers. The ring size bounds memory and
+// read-ahead. Consumers take filled blocks in file order and give them back
+// with release(), so parsing a block overlaps the reads of the next ones.
+// Every block holds whole lines only. A record that crosses a buffer
+// boundary is joined by the reader and handed out as the `lead` of the
+// block where it ends.
+// io_uring is not used: a single reader thread already keeps one
+// sequential stream busy, and it needs no extra library.
+class BlockReader {
+public:
+    struct Options {
+        size_t block_bytes = 4u << 20; // rounded up to the page size
+        size_t depth = 4;              // buffers in flight (at least 2)
+        int direct = -1;               // 1 = O_DIRECT, 0 = page cache, -1 = only for files over half of RAM
+    };
+    struct Block {
+        size_t seq = 0;
+        const char *data = nullptr; // whole lines; the last one ends in '\n' unless it ends the file
+        size_t size = 0;
+        size_t offset = 0;          // file offset of data
+        string lead;                // record that began in an earlier buffer, without its '\n'
+        size_t lead_offset = 0;
+        int buffer = -1;
+    };
+    struct Stats {
+        size_t bytes = 0;
+        size_t blocks = 0;
+        bool direct = false;
+        long long reader_wait_us = 0;   // reader waiting for a free buffer (parsing is the bottleneck)
+        long long consumer_wait_us = 0; // consumers waiting for data (I/O is the bottleneck)
+    };
+private:
+    int fd = -1;
+    size_t fileSize = 0, blockBytes = 0;
+    vector<char*> buffers;
+    vector<int> freeList;
+    deque<Block> ready;
+    bool finished = false, cancelled = false, failed = false;
+    mutex m;
+    condition_variable hasFree, hasReady;
+    thread reader;
+    Stats st;
+
+    void read_loop();
+    size_t read_full(char *buf, size_t offset);
+public:
+    BlockReader() = default;
+    ~BlockReader() { close(); }
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    // Opens the file and starts reading; false if it is missing or empty.
+    bool open(const string &filename, const Options &opt);
+    bool open(const string &filename) { return open(filename, Options()); }
+    size_t file_size() const { return fileSize; }
+    // Upper bound on the number of blocks (their seq values stay below it).
+    size_t max_blocks() const { return fileSize / blockBytes + 2; }
+    // Next block in file order; false once the file is exhausted or cancelled.
+    bool next(Block &b);
+    // Returns the buffer of a block from next() to the reader.
+    void release(Block &b);
+    // Stops reading early; blocked next() calls return false.
+    void cancel();
+    // Cancels and waits for the reader thread, then frees the buffers.
+    void close();
+    // True if a read failed; blocks after the failure are not delivered.
+    // Like stats(), only meaningful once next() has returned false.
+    bool error() const { return failed; }
+    Stats stats() const { return st; }
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "CourseDict.h"
+#include "Student.h" // CourseIDHash / CourseIDEq
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+// Deques keep element references stable while new courses are appended.
+struct DictState {
+    shared_mutex mtx;
+    unordered_map<CourseID, CourseKey, CourseIDHash, CourseIDEq> keys;
+    deque<CourseID> ids;
+    deque<string> names;
+};
+
+DictState& state() {
+    static DictState s;
+    return s;
+}
+}
+
+CourseKey CourseDict::intern(const CourseID &c) {
+    auto &s = state();
+    {
+        shared_lock<shared_mutex> lk(s.mtx);
+        auto it = s.keys.find(c);
+        if (it != s.keys.end()) return it->second;
+    }
+    unique_lock<shared_mutex> lk(s.mtx);
+    auto it = s.keys.find(c);
+    if (it != s.keys.end()) return it->second;
+    CourseKey k = (CourseKey)s.ids.size();
+    s.keys.emplace(c, k);
+    s.ids.push_back(c);
+    s.names.push_back(to_string_variant(c));
+    return k;
+}
+
+optional<CourseKey> CourseDict::find(const CourseID &c) {
+    auto &s = state();
+    shared_lock<shared_mutex> lk(s.mtx);
+    auto it = s.keys.find(c);
+    if (it == s.keys.end()) return nullopt;
+    return it->second;
+}
+
+CourseID CourseDict::lookup(CourseKey k) {
+    auto &s = state();
+    shared_lock<shared_mutex> lk(s.mtx);
+    return s.ids[k];
+}
+
+const string& CourseDict::name(CourseKey k) {
+    auto &s = state();
+    shared_lock<shared_mutex> lk(s.mtx);
+    return s.names[k];
+}
+
+size_t CourseDict::size() {
+    auto &s = state();
+    shared_lock<shared_mutex> lk(s.mtx);
+    return s.ids.size();
+}
@@ -0,0 +1,19 @@
+#ifndef COURSEDICT_H
+#define COURSEDICT_H
+
+#include "Types.h"
+#include <optional>
+
+// Process-wide dictionary interning each CourseID into a dense CourseKey.
+// Keys are assigned in first-seen order and never change, so hot paths can
+// store and compare plain integers and only display code maps back.
+class CourseDict {
+public:
+    static CourseKey intern(const CourseID &c);
+    static optional<CourseKey> find(const CourseID &c);
+    static CourseID lookup(CourseKey k);
+    static const string& name(CourseKey k);
+    static size_t size();
+};
+
+#endif
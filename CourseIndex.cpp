@@ -1,45 +1,85 @@
 #include "CourseIndex.h"
+#include "Metrics.h"
 #include <algorithm>
 
-void CourseIndex::build_from(vector<Student> &students) {
-    idx.clear();
-    for (auto &s : students) {
-        for (auto &p : s.get_courses()) idx[p.first].push_back(&s);
-        for (auto &p : s.get_prevCourses()) idx[p.first].push_back(&s);
-    }
-    for (auto &kv : idx) {
-        CourseID course = kv.first;
-        auto &vec = kv.second;
-        sort(vec.begin(), vec.end(), [&](const Student* A, const Student* B) {
-            auto ga = A->grade_for_course(course);
-            auto gb = B->grade_for_course(course);
-            if (ga && gb) {
-                if (*ga != *gb) return *ga > *gb;
-                return to_string_variant(A->get_roll()) < to_string_variant(B->get_roll());
-            }
-            return false; 
+bool CourseIndex::before(const Posting &a, const Posting &b) const {
+    if (a.grade != b.grade) return a.grade > b.grade;
+    int c = compare_roll((*students)[a.student].get_roll(), (*students)[b.student].get_roll());
+    if (c != 0) return c < 0;
+    return a.student < b.student;
+}
+
+void CourseIndex::build_from(const vector<Student> &students) {
+    Metrics::Timer timer(Phase::IndexBuild);
+    this->students = &students;
+    idx.assign(CourseDict::size(), {});
+    for (uint32_t i = 0; i < students.size(); ++i)
+        for_each_unique_course(students[i], [&](const CourseEntry &p) { idx[p.first].push_back({p.second, i}); });
+
+    // Rank students by roll once so the per-course sorts break ties on integers.
+    vector<uint32_t> byRoll(students.size()), rollRank(students.size());
+    for (uint32_t i = 0; i < byRoll.size(); ++i) byRoll[i] = i;
+    sort(byRoll.begin(), byRoll.end(), [&](uint32_t a, uint32_t b) {
+        int c = compare_roll(students[a].get_roll(), students[b].get_roll());
+        return c != 0 ? c < 0 : a < b;
+    });
+    for (uint32_t r = 0; r < byRoll.size(); ++r) rollRank[byRoll[r]] = r;
+    for (auto &vec : idx) {
+        sort(vec.begin(), vec.end(), [&](const Posting &A, const Posting &B) {
+            if (A.grade != B.grade) return A.grade > B.grade;
+            return rollRank[A.student] < rollRank[B.student];
         });
-        vec.erase(unique(vec.begin(), vec.end()), vec.end());
     }
 }
 
-vector<Student*> CourseIndex::top_students_for_course(const CourseID &c, Grade threshold) {
-    vector<Student*> out;
-    auto it = idx.find(c);
-    if (it == idx.end()) return out;
-    for (auto s : it->second) {
-        auto g = s->grade_for_course(c);
-        if (g && *g >= threshold) out.push_back(s);
-        else break;
-    }
-    return out;
+void CourseIndex::insert(uint32_t student) {
+    if (!students) return;
+    for_each_unique_course((*students)[student], [&](const CourseEntry &p) {
+        if (p.first >= idx.size()) idx.resize(p.first + 1);
+        // Binary search for the slot; shifting the tail is a single memmove.
+        auto &vec = idx[p.first];
+        Posting np{p.second, student};
+        vec.insert(lower_bound(vec.begin(), vec.end(), np, [&](const Posting &a, const Posting &b) { return before(a, b); }), np);
+    });
+}
+
+void CourseIndex::erase(uint32_t student) {
+    if (!students) return;
+    for_each_unique_course((*students)[student], [&](const CourseEntry &p) {
+        if (p.first >= idx.size()) return;
+        auto &vec = idx[p.first];
+        Posting op{p.second, student};
+        auto it = lower_bound(vec.begin(), vec.end(), op, [&](const Posting &a, const Posting &b) { return before(a, b); });
+        if (it != vec.end() && it->student == student) vec.erase(it);
+    });
+}
+
+vector<Posting> CourseIndex::top_students_for_course(const CourseID &c, Grade threshold) const {
+    Metrics::Timer timer(Phase::Query);
+    auto key = CourseDict::find(c);
+    if (!key || *key >= idx.size()) return {};
+    auto &vec = idx[*key];
+    auto end = partition_point(vec.begin(), vec.end(), [&](const Posting &p) { return p.grade >= threshold; });
+    return vector<Posting>(vec.begin(), end);
+}
+
+pair<const Posting*, const Posting*> CourseIndex::grade_range(const CourseID &c, Grade lo, Grade hi) const {
+    auto key = CourseDict::find(c);
+    if (!key || *key >= idx.size() || lo > hi) return {nullptr, nullptr};
+    auto &vec = idx[*key];
+    // Grades descend along the list, so the range is one contiguous slice.
+    auto first = partition_point(vec.begin(), vec.end(), [&](const Posting &p) { return p.grade > hi; });
+    auto last = partition_point(first, vec.end(), [&](const Posting &p) { return p.grade >= lo; });
+    return {vec.data() + (first - vec.begin()), vec.data() + (last - vec.begin())};
 }
 
 vector<CourseID> CourseIndex::get_all_courses() const {
-    vector<CourseID> courses;
-    for (auto &kv : idx) courses.push_back(kv.first);
-    sort(courses.begin(), courses.end(), [](const CourseID &a, const CourseID &b){
-        return to_string_variant(a) < to_string_variant(b);
+    vector<CourseKey> keys;
+    for (CourseKey k = 0; k < idx.size(); ++k) if (!idx[k].empty()) keys.push_back(k);
+    sort(keys.begin(), keys.end(), [](CourseKey a, CourseKey b) {
+        return CourseDict::name(a) < CourseDict::name(b);
     });
+    vector<CourseID> courses;
+    for (auto k : keys) courses.push_back(CourseDict::lookup(k));
     return courses;
-}
\ No newline at end of file
+}
@@ -2,16 +2,38 @@
 #define COURSEINDEX_H
 
 #include "Student.h"
-#include <unordered_map>
 #include <vector>
 
+// One entry of a course's posting list: the grade and the student's index.
+struct Posting {
+    Grade grade;
+    uint32_t student;
+};
+
+// Postings refer to students by their index in the vector passed to
+// build_from, so they stay valid when that vector reallocates. Adds and
+// deletes are applied with insert/erase instead of a rebuild.
 class CourseIndex {
 private:
-    unordered_map<CourseID, vector<Student*>, CourseIDHash, CourseIDEq> idx;
+    // Indexed by CourseKey; each list is ordered by grade (desc), then roll.
+    vector<vector<Posting>> idx;
+    const vector<Student> *students = nullptr;
+
+    bool before(const Posting &a, const Posting &b) const;
 public:
-    void build_from(vector<Student> &students);
-    vector<Student*> top_students_for_course(const CourseID &c, Grade threshold);
+    void build_from(const vector<Student> &students);
+    // Points a copy of the index at a copy of the vector it was built over.
+    void rebind(const vector<Student> &copy) { if (students) students = &copy; }
+    // Adds postings for students[student] (e.g. after a push_back).
+    void insert(uint32_t student);
+    // Removes postings for students[student]; call before the record changes or moves.
+    void erase(uint32_t student);
+
+    vector<Posting> top_students_for_course(const CourseID &c, Grade threshold) const;
+    // Postings of course c with lo <= grade <= hi, as a slice of its list (empty if unknown).
+    pair<const Posting*, const Posting*> grade_range(const CourseID &c, Grade lo, Grade hi) const;
     vector<CourseID> get_all_courses() const;
+    size_t student_count() const { return students ? students->size() : 0; }
 };
 
-#endif
\ No newline at end of file
+#endif
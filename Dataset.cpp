@@ -0,0 +1,74 @@
+#include "Dataset.h"
+#include <thread>
+
+DatasetVersion::DatasetVersion(const DatasetVersion &other)
+    : version(other.version), students(other.students), cidx(other.cidx), ridx(other.ridx),
+      ranks(other.ranks), names(other.names) {
+    cidx.rebind(students);
+    ridx.rebind(students);
+    ranks.rebind(students);
+    names.rebind(students);
+}
+
+void DatasetVersion::build() {
+    thread a([this]() { cidx.build_from(students); });
+    thread b([this]() { ridx.build_from(students); });
+    thread c([this]() { ranks.build_from(students); });
+    names.build_from(students);
+    a.join();
+    b.join();
+    c.join();
+}
+
+uint32_t DatasetVersion::add(const Student &s) {
+    students.push_back(s);
+    uint32_t h = students.size() - 1;
+    cidx.insert(h);
+    ridx.insert(h);
+    ranks.insert(h);
+    names.insert(h);
+    return h;
+}
+
+size_t DatasetVersion::remove(const RollID &roll_ref) {
+    RollID roll = roll_ref; // may refer into students, which changes below
+    size_t n = 0;
+    for (auto found = ridx.find_by_roll(roll); found; found = ridx.find_by_roll(roll), ++n) {
+        uint32_t i = *found, last = students.size() - 1;
+        cidx.erase(i);
+        ridx.erase(i);
+        ranks.erase(i);
+        names.erase(i);
+        if (i != last) {
+            cidx.erase(last);
+            ridx.relocate(last, i);
+            ranks.relocate(last, i);
+            names.relocate(last, i);
+            students[i] = move(students[last]);
+        }
+        students.pop_back();
+        if (i != last) cidx.insert(i);
+    }
+    return n;
+}
+
+Dataset::Dataset() {
+    auto empty = make_shared<DatasetVersion>();
+    empty->build(); // so later edits are indexed
+    current = move(empty);
+}
+
+uint64_t Dataset::publish(shared_ptr<DatasetVersion> next) {
+    next->version = snapshot()->version + 1;
+    uint64_t v = next->version;
+    atomic_store(&current, shared_ptr<const DatasetVersion>(move(next)));
+    return v;
+}
+
+uint64_t Dataset::reset(vector<Student> students) {
+    auto next = make_shared<DatasetVersion>();
+    next->students = move(students);
+    next->build();
+    lock_guard<mutex> lock(writer);
+    return publish(move(next));
+}
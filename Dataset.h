@@ -0,0 +1,64 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "CourseIndex.h"
+#include "RollIndex.h"
+#include "RankTable.h"
+#include "NameIndex.h"
+#include <memory>
+#include <mutex>
+
+// One immutable version of the dataset: the records and every index over
+// them. Once published a version is never changed, so it can be read from
+// any number of threads without locks.
+struct DatasetVersion {
+    uint64_t version = 0;
+    vector<Student> students;
+    CourseIndex cidx;
+    RollIndex ridx;
+    RankTable ranks;
+    NameIndex names;
+
+    DatasetVersion() = default;
+    // Copies the records and indexes, pointing the indexes at the copy.
+    DatasetVersion(const DatasetVersion &other);
+    DatasetVersion &operator=(const DatasetVersion &) = delete;
+
+    // Builds every index over students, each on its own thread.
+    void build();
+    // Edits for the next version (before it is published); indexes follow.
+    uint32_t add(const Student &s);
+    // Removes every record with this roll (swap-and-pop); returns how many.
+    size_t remove(const RollID &roll);
+};
+
+// RCU-style publication of dataset versions. Readers take snapshot() and
+// query that version for as long as they hold it, never blocking writers.
+// Writers are serialized: each copies the current version, edits the copy
+// and swaps it in with an atomic store. A version is freed when the last
+// reader holding it lets go.
+// Every write copies the records (O(n)), so callers should batch edits into
+// one modify() call where they can.
+class Dataset {
+private:
+    shared_ptr<const DatasetVersion> current;
+    mutex writer;
+
+    uint64_t publish(shared_ptr<DatasetVersion> next);
+public:
+    Dataset();
+
+    shared_ptr<const DatasetVersion> snapshot() const { return atomic_load(&current); }
+    // Publishes a new version holding these records; returns its number.
+    uint64_t reset(vector<Student> students);
+    // Applies edit(DatasetVersion&) to a copy of the current version and publishes it.
+    template <class Edit>
+    uint64_t modify(Edit &&edit) {
+        lock_guard<mutex> lock(writer);
+        auto next = make_shared<DatasetVersion>(*snapshot());
+        edit(*next);
+        return publish(move(next));
+    }
+};
+
+#endif
@@ -1,15 +1,28 @@
 #include "ERPUtils.h"
 #include "InputValidator.h" // for trim
+#include "Metrics.h"
+#include "BlockReader.h"
+#include "RowParser.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <thread>
+#include <mutex>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <charconv>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 using clk = chrono::high_resolution_clock;
 
+// Files at least this large are read through the pipeline in ReadMode::Auto.
+static const size_t PIPELINE_MIN_BYTES = 64u << 20;
+
 // Internal Helpers
 static bool looks_like_uint64(const string &s) {
     if (s.empty()) return false;
@@ -26,55 +39,222 @@ static bool looks_like_int(const string &s) {
     return true;
 }
 
-static vector<pair<CourseID, Grade>> parse_course_list(const string &s) {
-    vector<pair<CourseID, Grade>> out;
-    stringstream ss(s);
-    string token;
-    while (getline(ss, token, ';')) {
-        token = InputValidator::trim(token);
-        if (token.empty()) continue;
-        auto pos = token.find(':');
-        if (pos == string::npos) continue;
-        string cstr = InputValidator::trim(token.substr(0, pos));
-        string gstr = InputValidator::trim(token.substr(pos + 1));
-        Grade g = 0;
-        try { g = stod(gstr); } catch (...) { g = 0; }
-        CourseID cid = looks_like_int(cstr) ? CourseID(stoi(cstr)) : CourseID(cstr);
-        out.emplace_back(cid, g);
+// Parses every line in [begin, end), where begin sits at file offset base,
+// and hands each loaded record to sink along with its line's offset; stops
+// once sink returns false. Row outcomes are added to counts when given.
+template <class Sink>
+static size_t parse_lines(const char *begin, const char *end, size_t base, RowCounts *counts, Sink &&sink) {
+    Metrics::Timer timer(Phase::Parse);
+    RowParser parser(begin, end);
+    RowCounts seen;
+    Student s;
+    RowStatus status;
+    size_t offset, parsed = 0;
+    while (parser.next(s, status, offset)) {
+        seen.by_status[(int)status]++;
+        if (RowParser::rejects(status)) continue;
+        ++parsed;
+        if (!sink(s, base + offset)) break;
     }
-    return out;
+    Metrics::add(Counter::RowsParsed, parsed);
+    Metrics::add(Counter::RowsRejected, seen.rejected());
+    if (counts) counts->add(seen);
+    return parsed;
+}
+
+// Parses a BlockReader block: the record that crossed into it, then its own lines.
+template <class Sink>
+static size_t parse_block(const BlockReader::Block &b, RowCounts *counts, Sink &&sink) {
+    bool stopped = false;
+    auto keep = [&](Student &s, size_t offset) { return !(stopped = !sink(s, offset)); };
+    size_t n = 0;
+    if (!b.lead.empty()) n = parse_lines(b.lead.data(), b.lead.data() + b.lead.size(), b.lead_offset, counts, keep);
+    if (!stopped && b.size) n += parse_lines(b.data, b.data + b.size, b.offset, counts, keep);
+    return n;
+}
+
+// Parser stage of the pipelined read: `workers` threads take blocks from the
+// reader in file order and call handle(worker, block). A false return
+// cancels the read for everyone.
+template <class Handle>
+static void consume_blocks(BlockReader &reader, unsigned workers, Handle &&handle) {
+    auto work = [&](unsigned w) {
+        BlockReader::Block b;
+        while (reader.next(b)) {
+            bool more = handle(w, b);
+            reader.release(b);
+            if (!more) { reader.cancel(); break; }
+        }
+    };
+    vector<thread> threads;
+    for (unsigned w = 1; w < workers; ++w) threads.emplace_back(work, w);
+    work(0);
+    for (auto &t : threads) t.join();
+}
+
+static bool use_pipeline(const string &filename, ReadMode mode) {
+    if (mode != ReadMode::Auto) return mode == ReadMode::Pipelined;
+    struct stat sb;
+    return stat(filename.c_str(), &sb) == 0 && (size_t)sb.st_size >= PIPELINE_MIN_BYTES;
+}
+
+double LoadStats::mb_per_s() const {
+    if (duration_us <= 0) return 0.0;
+    return (bytes / (1024.0 * 1024.0)) / (duration_us / 1e6);
+}
+
+// Read-only mapping of a whole file; empty or unreadable files fail.
+static const char *map_file(const string &filename, size_t &size) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size <= 0) { close(fd); return nullptr; }
+    size = (size_t)sb.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return nullptr;
+    madvise(map, size, MADV_SEQUENTIAL);
+    Metrics::add(Counter::BytesRead, size);
+    return static_cast<const char*>(map);
 }
 
-size_t ERPUtils::load_csv(const string &filename, vector<Student> &students, size_t max_records) {
-    ifstream ifs(filename);
-    if (!ifs.is_open()) return 0;
-    string line;
+// Splits into newline-aligned chunks, one per worker; small files stay single-threaded.
+static vector<size_t> chunk_bounds(const char *data, size_t size, size_t nthreads) {
+    if (size < (1u << 20)) nthreads = 1;
+    vector<size_t> bounds(nthreads + 1, size);
+    bounds[0] = 0;
+    for (size_t i = 1; i < nthreads; ++i) {
+        size_t pos = max(bounds[i - 1], i * (size / nthreads));
+        const char *nl = pos < size ? static_cast<const char*>(memchr(data + pos, '\n', size - pos)) : nullptr;
+        bounds[i] = nl ? (size_t)(nl - data) + 1 : size;
+    }
+    return bounds;
+}
+
+// Moves the parsed chunks into students in file order, keeping at most
+// max_records (0 = all) rows.
+static size_t append_parts(vector<vector<Student>> &parts, vector<Student> &students, size_t max_records) {
+    size_t total = 0;
+    for (auto &p : parts) total += p.size();
+    if (max_records) total = min(total, max_records);
+    students.reserve(students.size() + total);
     size_t cnt = 0;
-    while (getline(ifs, line)) {
-        if (line.empty()) continue;
-        vector<string> fields;
-        string tmp;
-        stringstream ss(line);
-        while (getline(ss, tmp, ',')) fields.push_back(InputValidator::trim(tmp));
-        if (fields.size() < 4) continue;
-        while (fields.size() < 6) fields.push_back("");
-        try {
-            RollID rid = looks_like_uint64(fields[0]) ? RollID((uint64_t)stoull(fields[0])) : RollID(fields[0]);
-            string name = fields[1];
-            string branch = fields[2];
-            int startYear = 2020;
-            try { startYear = stoi(fields[3]); } catch (...) {}
-            Student s(rid, name, branch, startYear);
-            for (auto &p : parse_course_list(fields[4])) s.add_course(p.first, p.second, true);
-            if (!fields[5].empty()) for (auto &p : parse_course_list(fields[5])) s.add_course(p.first, p.second, false);
+    for (auto &p : parts) {
+        for (auto &s : p) {
+            if (cnt >= total) break;
             students.push_back(move(s));
             ++cnt;
-            if (max_records && cnt >= max_records) break;
-        } catch (...) { continue; }
+        }
     }
     return cnt;
 }
 
+size_t ERPUtils::load_csv(const string &filename, vector<Student> &students, size_t max_records, LoadStats *stats,
+                          ReadMode mode) {
+    Metrics::Timer timer(Phase::Load);
+    auto st = clk::now();
+    unsigned nthreads = max(1u, thread::hardware_concurrency());
+    size_t size = 0, cnt = 0;
+    RowCounts counts;
+
+    if (use_pipeline(filename, mode)) {
+        BlockReader reader;
+        if (!reader.open(filename)) return 0;
+        size = reader.file_size();
+        vector<vector<Student>> parts(reader.max_blocks());
+        // With a row limit, stop once the finished blocks before the first
+        // unfinished one hold enough rows.
+        mutex doneMtx;
+        vector<bool> done(parts.size());
+        size_t prefix = 0, prefixRows = 0;
+        vector<RowCounts> seen(nthreads);
+        consume_blocks(reader, nthreads, [&](unsigned w, BlockReader::Block &b) {
+            auto &part = parts[b.seq];
+            parse_block(b, &seen[w], [&](Student &s, size_t) {
+                part.push_back(move(s));
+                return !max_records || part.size() < max_records;
+            });
+            if (!max_records) return true;
+            lock_guard<mutex> lk(doneMtx);
+            done[b.seq] = true;
+            while (prefix < done.size() && done[prefix]) prefixRows += parts[prefix++].size();
+            return prefixRows < max_records;
+        });
+        reader.close();
+        cnt = append_parts(parts, students, max_records);
+        for (auto &c : seen) counts.add(c);
+    } else {
+        const char *data = map_file(filename, size);
+        if (!data) return 0;
+        auto bounds = chunk_bounds(data, size, nthreads);
+        size_t chunks = bounds.size() - 1;
+        vector<vector<Student>> parts(chunks);
+        vector<RowCounts> seen(chunks);
+        vector<thread> workers;
+        for (size_t i = 0; i < chunks; ++i)
+            workers.emplace_back([&, i]() {
+                parse_lines(data + bounds[i], data + bounds[i + 1], bounds[i], &seen[i], [&](Student &s, size_t) {
+                    parts[i].push_back(move(s));
+                    return !max_records || parts[i].size() < max_records;
+                });
+            });
+        for (auto &w : workers) w.join();
+        munmap(const_cast<char*>(data), size);
+        cnt = append_parts(parts, students, max_records);
+        for (auto &c : seen) counts.add(c);
+    }
+
+    if (stats) {
+        stats->bytes = size;
+        stats->rows = cnt;
+        stats->issues = counts;
+        stats->duration_us = chrono::duration_cast<chrono::microseconds>(clk::now() - st).count();
+    }
+    return cnt;
+}
+
+size_t ERPUtils::scan_csv(const string &filename, const function<void(unsigned, Student&, size_t)> &visit,
+                          unsigned threads, ReadMode mode) {
+    Metrics::Timer timer(Phase::Load);
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    if (use_pipeline(filename, mode)) {
+        BlockReader reader;
+        if (!reader.open(filename)) return 0;
+        vector<size_t> counts(threads);
+        consume_blocks(reader, threads, [&](unsigned w, BlockReader::Block &b) {
+            counts[w] += parse_block(b, nullptr, [&](Student &s, size_t offset) {
+                visit(w, s, offset);
+                return true;
+            });
+            return true;
+        });
+        size_t total = 0;
+        for (size_t c : counts) total += c;
+        return total;
+    }
+
+    size_t size = 0;
+    const char *data = map_file(filename, size);
+    if (!data) return 0;
+    auto bounds = chunk_bounds(data, size, threads);
+    size_t nthreads = bounds.size() - 1;
+    vector<size_t> counts(nthreads);
+    vector<thread> workers;
+    for (size_t i = 0; i < nthreads; ++i)
+        workers.emplace_back([&, i]() {
+            counts[i] = parse_lines(data + bounds[i], data + bounds[i + 1], bounds[i], nullptr, [&](Student &s, size_t offset) {
+                visit((unsigned)i, s, offset);
+                return true;
+            });
+        });
+    for (auto &w : workers) w.join();
+    munmap(const_cast<char*>(data), size);
+    size_t total = 0;
+    for (size_t c : counts) total += c;
+    return total;
+}
+
 static void write_student_to_stream(ostream& ofs, const Student& s) {
     ofs << to_string_variant(s.get_roll()) << ",";
     ofs << s.get_name() << ",";
@@ -83,23 +263,54 @@ static void write_student_to_stream(ostream& ofs, const Student& s) {
     const auto& curr = s.get_courses();
     for(size_t i=0; i<curr.size(); ++i) {
         if (i > 0) ofs << ";";
-        ofs << to_string_variant(curr[i].first) << ":" << fixed << setprecision(1) << curr[i].second;
+        ofs << CourseDict::name(curr[i].first) << ":" << fixed << setprecision(1) << curr[i].second;
     }
     ofs << ",";
     const auto& prev = s.get_prevCourses();
     for(size_t i=0; i<prev.size(); ++i) {
         if (i > 0) ofs << ";";
-        ofs << to_string_variant(prev[i].first) << ":" << fixed << setprecision(1) << prev[i].second;
+        ofs << CourseDict::name(prev[i].first) << ":" << fixed << setprecision(1) << prev[i].second;
     }
     ofs << "\n";
 }
 
+bool ERPUtils::parse_student(const string &line, Student &out, RowStatus *status) {
+    RowParser parser(line.data(), line.data() + line.size());
+    RowStatus st = RowStatus::TooFewFields;
+    size_t offset;
+    bool ok = parser.next(out, st, offset) && !RowParser::rejects(st);
+    if (status) *status = st;
+    return ok;
+}
+
+string ERPUtils::format_student(const Student &s) {
+    stringstream ss;
+    write_student_to_stream(ss, s);
+    string rec = ss.str();
+    rec.pop_back(); // trailing newline
+    return rec;
+}
+
+string ERPUtils::roll_text(const string &field) {
+    string f = InputValidator::trim(field);
+    uint64_t v;
+    if (looks_like_uint64(f) && from_chars(f.data(), f.data() + f.size(), v).ec == errc()) return to_string(v);
+    return f;
+}
+
+CourseID ERPUtils::parse_course_id(const string &text) {
+    int v;
+    if (looks_like_int(text) && from_chars(text.data(), text.data() + text.size(), v).ec == errc()) return CourseID(v);
+    return CourseID(text);
+}
+
 void ERPUtils::append_student_to_csv(const Student& s, const string& filename) {
     ofstream ofs(filename, ios::app);
     if (ofs.is_open()) { write_student_to_stream(ofs, s); ofs.close(); }
 }
 
 void ERPUtils::save_all_students_to_csv(const vector<Student>& students, const string& filename) {
+    Metrics::Timer timer(Phase::Save);
     ofstream ofs(filename, ios::trunc);
     if (ofs.is_open()) {
         for(const auto& s : students) write_student_to_stream(ofs, s);
@@ -107,7 +318,7 @@ void ERPUtils::save_all_students_to_csv(const vector<Student>& students, const s
     }
 }
 
-// Sorting Comparator
+// Sorting Comparator: name, then roll as printed, then index so the order is total.
 struct IndexComparator {
     const vector<Student>& students;
     IndexComparator(const vector<Student> &s) : students(s) {}
@@ -115,29 +326,66 @@ struct IndexComparator {
         const Student &A = students[a];
         const Student &B = students[b];
         if (A.get_name() != B.get_name()) return A.get_name() < B.get_name();
-        return to_string_variant(A.get_roll()) < to_string_variant(B.get_roll());
+        int c = compare_roll(A.get_roll(), B.get_roll());
+        if (c != 0) return c < 0;
+        return a < b;
     }
 };
 
-void ERPUtils::parallel_sort_indices(vector<size_t>& indices, const vector<Student> &students, ThreadTimer &t1, ThreadTimer &t2) {
-    if (indices.empty()) return;
-    size_t n = indices.size();
-    if (n <= 1) return;
-    size_t mid = n / 2;
-    IndexComparator comp(students);
-    auto worker1 = [&]() {
-        auto st = clk::now();
-        sort(indices.begin(), indices.begin() + mid, comp);
-        auto ed = clk::now();
-        t1.duration_ms = chrono::duration_cast<chrono::milliseconds>(ed - st).count();
-    };
-    auto worker2 = [&]() {
-        auto st = clk::now();
-        sort(indices.begin() + mid, indices.end(), comp);
-        auto ed = clk::now();
-        t2.duration_ms = chrono::duration_cast<chrono::milliseconds>(ed - st).count();
-    };
-    thread th1(worker1), th2(worker2);
-    th1.join(); th2.join();
-    inplace_merge(indices.begin(), indices.begin() + mid, indices.end(), comp);
-}
\ No newline at end of file
+// Normalized key for SortMode::Keys: the first 16 bytes of the name and of the
+// printed roll packed big-endian into integer pairs, so comparing the integers
+// orders them like string compare. Only when a prefix ties and a string is
+// longer than 16 bytes do we fall back to the full strings, compared in place.
+struct SortKey {
+    uint64_t name[2];
+    uint64_t roll[2];
+    uint32_t index;
+    uint8_t nameLong, rollLong;
+};
+
+struct KeyComparator {
+    const vector<Student>& students;
+    KeyComparator(const vector<Student> &s) : students(s) {}
+    bool operator()(const SortKey &a, const SortKey &b) const {
+        if (a.name[0] != b.name[0]) return a.name[0] < b.name[0];
+        if (a.name[1] != b.name[1]) return a.name[1] < b.name[1];
+        if (a.nameLong | b.nameLong) {
+            int c = students[a.index].get_name().compare(students[b.index].get_name());
+            if (c != 0) return c < 0;
+        }
+        if (a.roll[0] != b.roll[0]) return a.roll[0] < b.roll[0];
+        if (a.roll[1] != b.roll[1]) return a.roll[1] < b.roll[1];
+        if (a.rollLong | b.rollLong) {
+            int c = compare_roll(students[a.index].get_roll(), students[b.index].get_roll());
+            if (c != 0) return c < 0;
+        }
+        return a.index < b.index;
+    }
+};
+
+void ERPUtils::parallel_sort_indices(vector<size_t>& indices, const vector<Student> &students, SortTimings &timings, unsigned threads, SortMode mode) {
+    Metrics::Timer timer(Phase::Sort);
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    ThreadPool pool(threads - 1);
+    if (mode == SortMode::Comparator) {
+        ParallelSort::sort(indices, IndexComparator(students), pool, &timings);
+        return;
+    }
+    auto st = chrono::steady_clock::now();
+    vector<SortKey> keys(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const Student &s = students[indices[i]];
+        char buf[24];
+        string_view roll = roll_view(s.get_roll(), buf);
+        SortKey &k = keys[i];
+        ParallelSort::pack_prefix(s.get_name(), k.name);
+        ParallelSort::pack_prefix(roll, k.roll);
+        k.index = (uint32_t)indices[i];
+        k.nameLong = s.get_name().size() > 16;
+        k.rollLong = roll.size() > 16;
+    }
+    auto keyMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - st).count();
+    ParallelSort::sort(keys, KeyComparator(students), pool, &timings);
+    for (size_t i = 0; i < keys.size(); ++i) indices[i] = keys[i].index;
+    timings.total_ms += keyMs;
+}
@@ -2,16 +2,65 @@
 #define ERPUTILS_H
 
 #include "Student.h"
+#include "ParallelSort.h" // SortTimings
+#include "RowParser.h"
 #include <vector>
 #include <string>
+#include <functional>
 
-struct ThreadTimer { long long duration_ms = 0; };
+// Comparator: sort indices directly with the name/roll comparator.
+// Keys: build compact prefix keys first, then sort those (no allocation).
+enum class SortMode { Comparator, Keys };
+
+// How load_csv and scan_csv read the file. Mapped: mmap it and parse
+// newline-aligned chunks in parallel. Pipelined: a reader thread streams it
+// in aligned blocks (see BlockReader.h) while parser threads consume them,
+// so disk reads overlap parsing. Auto: pipelined for files of 64 MB or more.
+enum class ReadMode { Auto, Mapped, Pipelined };
+
+// Filled by load_csv when requested: input size, rows kept, wall time and
+// the rows that were rejected or loaded with defaults.
+struct LoadStats {
+    size_t bytes = 0;
+    size_t rows = 0;
+    RowCounts issues;
+    long long duration_us = 0;
+    double mb_per_s() const;
+};
 
 namespace ERPUtils {
-    size_t load_csv(const string &filename, vector<Student> &students, size_t max_records = 0);
+    size_t load_csv(const string &filename, vector<Student> &students, size_t max_records = 0, LoadStats *stats = nullptr,
+                    ReadMode mode = ReadMode::Auto);
+    // Streams the records of a CSV without keeping them: the file is parsed on
+    // `threads` threads (0 = hardware_concurrency; small mapped files use one)
+    // and visit(worker, record, byte offset of its line) is called from the
+    // worker's thread. Each worker sees its offsets in increasing order.
+    // Returns the number of records parsed.
+    size_t scan_csv(const string &filename, const function<void(unsigned, Student&, size_t)> &visit, unsigned threads = 0,
+                    ReadMode mode = ReadMode::Auto);
     void append_student_to_csv(const Student& s, const string& filename);
     void save_all_students_to_csv(const vector<Student>& students, const string& filename);
-    void parallel_sort_indices(vector<size_t>& indices, const vector<Student> &students, ThreadTimer &t1, ThreadTimer &t2);
+
+    // Single-record helpers: one CSV line <-> Student, and the canonical
+    // text of a roll field (as to_string_variant prints the parsed roll).
+    // status, when given, says why a record was rejected or repaired.
+    bool parse_student(const string &line, Student &out, RowStatus *status = nullptr);
+    string format_student(const Student &s);
+    string roll_text(const string &field);
+    // Course code text as the loader reads it: all digits -> int, anything else -> string.
+    CourseID parse_course_id(const string &text);
+
+    // Binary columnar snapshots (see Snapshot.h for the layout).
+    bool save_snapshot(const vector<Student>& students, const string& filename);
+    size_t load_snapshot(const string &filename, vector<Student> &students, size_t max_records = 0, LoadStats *stats = nullptr);
+    string snapshot_path(const string &csv_file);
+    bool snapshot_is_fresh(const string &csv_file);
+    size_t convert_csv_to_snapshot(const string &csv_file, const string &snap_file);
+    size_t convert_snapshot_to_csv(const string &snap_file, const string &csv_file);
+
+    // Sorts by name, then roll, then index on `threads` threads (0 = hardware_concurrency).
+    void parallel_sort_indices(vector<size_t>& indices, const vector<Student> &students, SortTimings &timings,
+                               unsigned threads = 0, SortMode mode = SortMode::Keys);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "ExternalSort.h"
+#include "ERPUtils.h"
+#include "Metrics.h"
+#include "ParallelSort.h"
+#include <string_view>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using clk = chrono::steady_clock;
+
+namespace {
+const size_t MIN_BUFFER = 256u << 10; // smallest read buffer per merged run
+
+string_view trim_view(string_view s) {
+    size_t a = 0, b = s.size();
+    while (a < b && isspace((unsigned char)s[a])) ++a;
+    while (b > a && isspace((unsigned char)s[b - 1])) --b;
+    return s.substr(a, b - a);
+}
+
+// Sort key of a CSV line: trimmed name and canonical roll text. False for
+// lines the loader skips (fewer than four comma-separated fields).
+bool line_key(string_view line, string_view &name, string &roll) {
+    size_t c1 = line.find(',');
+    size_t c2 = c1 == string_view::npos ? c1 : line.find(',', c1 + 1);
+    size_t c3 = c2 == string_view::npos ? c2 : line.find(',', c2 + 1);
+    if (c3 == string_view::npos || c3 + 1 >= line.size()) return false;
+    name = trim_view(line.substr(c1 + 1, c2 - c1 - 1));
+    roll = ERPUtils::roll_text(string(line.substr(0, c1)));
+    return true;
+}
+
+// Name, then roll as printed: the order of IndexComparator.
+int compare_key(string_view na, string_view ra, string_view nb, string_view rb) {
+    int c = na.compare(nb);
+    return c != 0 ? c : ra.compare(rb);
+}
+
+// Sequential line reader over a file descriptor with its own buffer.
+class LineReader {
+private:
+    int fd;
+    vector<char> buf;
+    size_t pos = 0, end = 0, start = 0;
+    bool eof = false;
+public:
+    LineReader(int f, size_t size) : fd(f), buf(max<size_t>(size, 4096)) {}
+    // Next line without its newline; the view stays valid until the next call.
+    bool next(string_view &line) {
+        while (true) {
+            const char *nl = pos < end ? static_cast<const char*>(memchr(buf.data() + pos, '\n', end - pos)) : nullptr;
+            start = pos;
+            if (nl) {
+                line = string_view(buf.data() + pos, nl - (buf.data() + pos));
+                pos = nl - buf.data() + 1;
+                return true;
+            }
+            if (eof) {
+                if (pos == end) return false;
+                line = string_view(buf.data() + pos, end - pos);
+                pos = end;
+                return true;
+            }
+            memmove(buf.data(), buf.data() + pos, end - pos);
+            end -= pos;
+            pos = 0;
+            if (end == buf.size()) buf.resize(buf.size() * 2);
+            ssize_t r = read(fd, buf.data() + end, buf.size() - end);
+            if (r <= 0) eof = true;
+            else end += (size_t)r;
+        }
+    }
+    // Hands the line last returned by next() out again on the following call.
+    void unread() { pos = start; }
+};
+
+class Writer {
+private:
+    int fd;
+    string buf;
+    size_t cap;
+public:
+    bool ok = true;
+    Writer(int f, size_t size) : fd(f), cap(max<size_t>(size, 4096)) { buf.reserve(cap); }
+    void line(string_view s) {
+        if (buf.size() + s.size() + 1 > cap) flush();
+        buf.append(s.data(), s.size());
+        buf += '\n';
+    }
+    void flush() {
+        for (size_t off = 0; off < buf.size() && ok;) {
+            ssize_t w = write(fd, buf.data() + off, buf.size() - off);
+            if (w <= 0) ok = false;
+            else off += (size_t)w;
+        }
+        buf.clear();
+    }
+};
+
+// One in-memory run: line text and canonical rolls in an arena, plus a
+// record per line. Records start with an 8-byte big-endian name prefix so
+// most comparisons never touch the arena.
+struct Run {
+    struct Rec {
+        uint64_t prefix;
+        uint32_t line, len, name, nameLen, roll, rollLen;
+    };
+    string arena;
+    vector<Rec> recs;
+};
+
+uint64_t prefix_of(string_view s) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < 8; ++i) v = (v << 8) | (i < s.size() ? (unsigned char)s[i] : 0);
+    return v;
+}
+
+// Reads lines into run until its arena or records are full; false once the
+// input is exhausted. Both are reserved up front from the arena bytes per line
+// seen so far, and sorting needs a second record array (ParallelSort's merge
+// buffer), so the run never takes more than budget bytes.
+bool fill(LineReader &in, Run &run, size_t budget, size_t bytesPerRec, ExternalSort::Stats &st) {
+    size_t recs = max<size_t>(1, budget / (bytesPerRec + 2 * sizeof(Run::Rec)));
+    run.recs.reserve(recs);
+    run.arena.reserve(budget - min(budget, 2 * recs * sizeof(Run::Rec)));
+    string_view line, name;
+    string roll;
+    while (run.recs.size() < recs) {
+        if (!in.next(line)) return false;
+        if (!line_key(line, name, roll)) {
+            st.bytes += line.size() + 1;
+            if (!trim_view(line).empty()) st.skipped++;
+            continue;
+        }
+        // A line longer than the whole arena still gets a run of its own.
+        if (!run.recs.empty() && run.arena.size() + line.size() + roll.size() > run.arena.capacity()) {
+            in.unread();
+            return true;
+        }
+        st.bytes += line.size() + 1;
+        Run::Rec r;
+        r.prefix = prefix_of(name);
+        r.line = (uint32_t)run.arena.size();
+        r.len = (uint32_t)line.size();
+        r.name = r.line + (uint32_t)(name.data() - line.data());
+        r.nameLen = (uint32_t)name.size();
+        run.arena.append(line.data(), line.size());
+        r.roll = (uint32_t)run.arena.size();
+        r.rollLen = (uint32_t)roll.size();
+        run.arena += roll;
+        run.recs.push_back(r);
+    }
+    return true;
+}
+
+void sort_run(Run &run, ThreadPool &pool) {
+    const char *a = nullptr;
+    auto view = [&](uint32_t off, uint32_t len) { return string_view(a + off, len); };
+    a = run.arena.data();
+    // Arena offsets grow with input order, so they break ties stably.
+    ParallelSort::sort(run.recs, [&](const Run::Rec &x, const Run::Rec &y) {
+        if (x.prefix != y.prefix) return x.prefix < y.prefix;
+        int c = compare_key(view(x.name, x.nameLen), view(x.roll, x.rollLen), view(y.name, y.nameLen), view(y.roll, y.rollLen));
+        return c != 0 ? c < 0 : x.line < y.line;
+    }, pool);
+}
+
+bool write_run(const Run &run, const string &file) {
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    Writer w(fd, 1u << 20);
+    for (auto &r : run.recs) w.line(string_view(run.arena.data() + r.line, r.len));
+    w.flush();
+    return close(fd) == 0 && w.ok;
+}
+
+// k-way merge of runs (in input order) into out; ties go to the earlier run.
+bool merge_runs(const vector<string> &runs, const string &out, size_t memory) {
+    size_t k = runs.size();
+    size_t bufSize = max(MIN_BUFFER, memory / (k + 1));
+    vector<int> fds;
+    vector<LineReader> readers;
+    for (auto &f : runs) {
+        int fd = open(f.c_str(), O_RDONLY);
+        if (fd < 0) { for (int d : fds) close(d); return false; }
+        fds.push_back(fd);
+        readers.emplace_back(fd, bufSize);
+    }
+    int ofd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (ofd < 0) { for (int d : fds) close(d); return false; }
+    Writer w(ofd, bufSize);
+
+    vector<string_view> line(k), name(k);
+    vector<string> roll(k);
+    auto advance = [&](size_t r) {
+        while (readers[r].next(line[r]))
+            if (line_key(line[r], name[r], roll[r])) return true;
+        return false;
+    };
+    auto later = [&](size_t a, size_t b) {
+        int c = compare_key(name[a], roll[a], name[b], roll[b]);
+        return c != 0 ? c > 0 : a > b;
+    };
+    vector<size_t> heap;
+    for (size_t r = 0; r < k; ++r) if (advance(r)) heap.push_back(r);
+    make_heap(heap.begin(), heap.end(), later);
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), later);
+        size_t r = heap.back();
+        w.line(line[r]);
+        if (advance(r)) push_heap(heap.begin(), heap.end(), later);
+        else heap.pop_back();
+    }
+    w.flush();
+    for (int d : fds) close(d);
+    return close(ofd) == 0 && w.ok;
+}
+}
+
+bool ExternalSort::sort_csv(const string &in_file, const string &out_file, const Options &opt, Stats *stats) {
+    Metrics::Timer timer(Phase::Sort);
+    Stats st;
+    auto t0 = clk::now();
+    unsigned threads = opt.threads ? opt.threads : max(1u, thread::hardware_concurrency());
+    ThreadPool pool(threads - 1);
+    size_t memory = max<size_t>(opt.memory_bytes, 4 * MIN_BUFFER);
+    // The input buffer comes out of the budget. Two runs are in memory at once
+    // (one filling, one sorting); offsets are 32-bit.
+    size_t readBuffer = min<size_t>(4u << 20, memory / 16);
+    size_t budget = min<size_t>((memory - readBuffer) / 2, 0xF0000000u);
+    string dir = opt.temp_dir;
+    if (dir.empty()) {
+        auto slash = out_file.rfind('/');
+        dir = slash == string::npos ? "." : out_file.substr(0, slash + (slash == 0));
+    }
+    string prefix = dir + "/.erp_sort_" + to_string(getpid()) + "_";
+    string tmp_out = out_file + ".tmp";
+
+    int ifd = open(in_file.c_str(), O_RDONLY);
+    if (ifd < 0) return false;
+    LineReader in(ifd, readBuffer);
+    vector<string> runs;
+    auto cleanup = [&]() { for (auto &f : runs) unlink(f.c_str()); };
+
+    // Run generation: read run i+1 in the background while run i is sorted and spilled.
+    bool ok = true;
+    Run cur;
+    bool more = fill(in, cur, budget, 64, st);
+    while (ok && !cur.recs.empty()) {
+        Run next;
+        bool nextMore = false;
+        size_t perRec = cur.arena.size() / cur.recs.size() + 1;
+        thread reader;
+        if (more) reader = thread([&]() { nextMore = fill(in, next, budget, perRec, st); });
+        sort_run(cur, pool);
+        st.rows += cur.recs.size();
+        // A single run goes straight to the output.
+        string file = (runs.empty() && !more) ? tmp_out : prefix + to_string(runs.size()) + ".run";
+        if (file != tmp_out) runs.push_back(file);
+        ok = write_run(cur, file);
+        if (reader.joinable()) reader.join();
+        if (file == tmp_out) break;
+        // Swap rather than move-assign: the written run's buffers go with
+        // next at the end of the iteration (moving an empty string into cur
+        // would keep cur's arena allocated through the merge).
+        swap(cur, next);
+        more = nextMore;
+    }
+    close(ifd);
+    st.runs = max<size_t>(runs.size(), st.rows ? 1 : 0);
+    auto t1 = clk::now();
+
+    // Merge: passes over groups of `fanout` consecutive runs until one pass can finish.
+    size_t fanout = max<size_t>(2, memory / MIN_BUFFER - 1);
+    size_t gen = 0;
+    while (ok && !runs.empty()) {
+        st.merge_passes++;
+        if (runs.size() <= fanout) {
+            ok = merge_runs(runs, tmp_out, memory);
+            cleanup();
+            runs.clear();
+            break;
+        }
+        vector<string> merged;
+        for (size_t i = 0; ok && i < runs.size(); i += fanout) {
+            vector<string> group(runs.begin() + i, runs.begin() + min(runs.size(), i + fanout));
+            string file = prefix + "m" + to_string(gen++) + ".run";
+            merged.push_back(file);
+            ok = merge_runs(group, file, memory);
+            for (auto &f : group) unlink(f.c_str());
+        }
+        runs.swap(merged);
+    }
+    if (ok && st.rows == 0) {
+        int fd = open(tmp_out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = fd >= 0 && close(fd) == 0;
+    }
+    cleanup();
+    ok = ok && rename(tmp_out.c_str(), out_file.c_str()) == 0;
+    if (!ok) unlink(tmp_out.c_str());
+
+    Metrics::add(Counter::BytesRead, st.bytes);
+    st.run_ms = chrono::duration_cast<chrono::milliseconds>(t1 - t0).count();
+    st.merge_ms = chrono::duration_cast<chrono::milliseconds>(clk::now() - t1).count();
+    if (stats) *stats = st;
+    return ok;
+}
@@ -0,0 +1,37 @@
+#ifndef EXTERNALSORT_H
+#define EXTERNALSORT_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Out-of-core sort of a student CSV into name, then roll order (the order of
+// parallel_sort_indices; equal keys keep their input order). Input is read
+// in runs that fit the memory budget. While one run is sorted on the thread
+// pool and spilled to a temp file, the next run is read in the background.
+// The runs are then k-way merged into the output; when there are more runs
+// than the budget can buffer, merging takes several passes.
+// Lines are copied verbatim. Lines the loader would skip (fewer than four
+// fields) are dropped.
+namespace ExternalSort {
+    struct Options {
+        size_t memory_bytes = 256u << 20;  // runs, the sort's merge buffer and read buffers
+        unsigned threads = 0;  // 0 = hardware_concurrency
+        string temp_dir;       // default: the output file's directory
+    };
+    struct Stats {
+        size_t rows = 0;
+        size_t skipped = 0;
+        size_t bytes = 0;
+        size_t runs = 0;
+        size_t merge_passes = 0;
+        long long run_ms = 0;
+        long long merge_ms = 0;
+    };
+
+    // False if a file could not be read or written; the output is replaced atomically.
+    bool sort_csv(const string &in_file, const string &out_file, const Options &opt, Stats *stats = nullptr);
+}
+
+#endif
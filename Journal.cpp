@@ -0,0 +1,249 @@
+#include "Journal.h"
+#include "ERPUtils.h"
+#include "Metrics.h"
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool file_exists(const string &f) {
+    struct stat sb;
+    return stat(f.c_str(), &sb) == 0;
+}
+
+static bool fsync_path(const string &path, bool directory = false) {
+    int fd = open(path.c_str(), directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+static string dir_of(const string &path) {
+    auto pos = path.find_last_of('/');
+    return pos == string::npos ? "." : path.substr(0, pos + 1);
+}
+
+// Size and modification time of a base CSV; "-" when it does not exist.
+static string base_id(const string &f) {
+    struct stat sb;
+    if (stat(f.c_str(), &sb) != 0) return "-";
+    return to_string(sb.st_size) + "," + to_string(sb.st_mtim.tv_sec) + "." + to_string(sb.st_mtim.tv_nsec);
+}
+
+// Operation lines of journal f, plus the base identities it records.
+static size_t count_ops(const string &f, vector<string> &bases) {
+    ifstream ifs(f);
+    size_t n = 0;
+    string line;
+    while (getline(ifs, line)) {
+        if (line.rfind("B,", 0) == 0) bases.push_back(line.substr(2));
+        else if (!line.empty()) ++n;
+    }
+    return n;
+}
+
+Journal::Journal(string csv)
+    : csv_file(move(csv)), journal_file(csv_file + ".journal"), frozen_file(csv_file + ".journal.compacting") {
+    ops = count_ops(journal_file, bases);
+    open_journal();
+}
+
+Journal::~Journal() {
+    wait();
+    if (fd >= 0) close(fd);
+}
+
+// Opens the live journal; a new one starts with the identity of the current base.
+void Journal::open_journal() {
+    fd = open(journal_file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    struct stat sb;
+    if (fd >= 0 && fstat(fd, &sb) == 0 && sb.st_size == 0) {
+        bases.clear();
+        note_base(base_id(csv_file));
+    }
+}
+
+void Journal::note_base(const string &id) {
+    string rec = "B," + id + "\n";
+    if (write(fd, rec.data(), rec.size()) == (ssize_t)rec.size()) bases.push_back(id);
+}
+
+// One write() per record: O_APPEND keeps concurrent appends whole.
+void Journal::append_line(const string &line) {
+    {
+        lock_guard<mutex> lk(mtx);
+        if (fd < 0) open_journal();
+        if (fd < 0) return;
+        // The base was replaced under a journal that records its base: those
+        // operations are ignored on load, so start the journal over.
+        string id = base_id(csv_file);
+        if (!bases.empty() && find(bases.begin(), bases.end(), id) == bases.end()) {
+            if (ftruncate(fd, 0) != 0) return;
+            ops = 0;
+            bases.clear();
+            note_base(id);
+        }
+        string rec = line + "\n";
+        if (write(fd, rec.data(), rec.size()) != (ssize_t)rec.size()) return;
+        ++ops;
+        if (ops < COMPACT_THRESHOLD) return;
+    }
+    compact_async();
+}
+
+void Journal::log_add(const Student &s) { append_line("A," + ERPUtils::format_student(s)); }
+void Journal::log_update(const Student &s) { append_line("U," + ERPUtils::format_student(s)); }
+void Journal::log_delete(const RollID &r) { append_line("D," + to_string_variant(r)); }
+
+size_t Journal::pending_ops() const {
+    lock_guard<mutex> lk(mtx);
+    return ops;
+}
+
+// Last operation per roll in journal file f (an empty body for a delete),
+// and the rolls in the order they first appear. Returns the operations read;
+// a journal recording bases other than `base` only is read as empty.
+static size_t read_ops(const string &f, const string &base, unordered_map<string, string> &last, vector<string> &order) {
+    ifstream ifs(f);
+    string line;
+    size_t n = 0;
+    bool recorded = false, matches = false;
+    while (getline(ifs, line)) {
+        if (line.rfind("B,", 0) == 0) {
+            recorded = true;
+            matches = matches || line.compare(2, string::npos, base) == 0;
+            continue;
+        }
+        if (line.size() < 2 || line[1] != ',') continue;
+        string body = line.substr(2);
+        string roll;
+        if (line[0] == 'D') roll = ERPUtils::roll_text(body);
+        else if (line[0] == 'A' || line[0] == 'U') roll = ERPUtils::roll_text(body.substr(0, body.find(',')));
+        else continue;
+        if (!last.count(roll)) order.push_back(roll);
+        last[roll] = line[0] == 'D' ? string() : body;
+        ++n;
+    }
+    if (recorded && !matches) {
+        last.clear();
+        order.clear();
+        return 0;
+    }
+    return n;
+}
+
+// Folds each file the way compact_files folds it into the base: records of
+// untouched rolls keep their order, then the final record of every touched
+// roll follows in first-touch order. Over the frozen then the live file that
+// drops every roll either touches and adds the frozen survivors the live file
+// leaves alone, then the live ones, so replaying and compacting give the same
+// records in the same order.
+size_t Journal::changes(const string &csv_file, unordered_set<string> &dropped, vector<Student> &added) {
+    unordered_map<string, string> frozen, live;
+    vector<string> frozenOrder, liveOrder;
+    string base = base_id(csv_file);
+    size_t n = read_ops(csv_file + ".journal.compacting", base, frozen, frozenOrder);
+    n += read_ops(csv_file + ".journal", base, live, liveOrder);
+    auto add = [&](const string &body) {
+        Student s;
+        if (!body.empty() && ERPUtils::parse_student(body, s)) added.push_back(move(s));
+    };
+    for (auto &roll : frozenOrder) {
+        dropped.insert(roll);
+        if (!live.count(roll)) add(frozen[roll]);
+    }
+    for (auto &roll : liveOrder) {
+        dropped.insert(roll);
+        add(live[roll]);
+    }
+    return n;
+}
+
+size_t Journal::replay(vector<Student> &students) const {
+    unordered_set<string> dropped;
+    vector<Student> added;
+    size_t applied = changes(csv_file, dropped, added);
+    if (dropped.empty()) return applied;
+    size_t keep = 0;
+    for (size_t i = 0; i < students.size(); ++i) {
+        if (dropped.count(to_string_variant(students[i].get_roll()))) continue;
+        if (keep != i) students[keep] = move(students[i]);
+        ++keep;
+    }
+    students.erase(students.begin() + keep, students.end());
+    for (auto &s : added) students.push_back(move(s));
+    return applied;
+}
+
+void Journal::compact_async() {
+    if (running.exchange(true)) return;
+    if (worker.joinable()) worker.join();
+    {
+        // Freeze the live journal unless a crashed compaction left one behind;
+        // new operations go to a fresh journal meanwhile.
+        lock_guard<mutex> lk(mtx);
+        if (!file_exists(frozen_file)) {
+            if (ops == 0) { running = false; return; }
+            if (fd >= 0) close(fd);
+            rename(journal_file.c_str(), frozen_file.c_str());
+            open_journal();
+            ops = 0;
+        }
+    }
+    worker = thread([this]() {
+        compact_files();
+        running = false;
+    });
+}
+
+void Journal::wait() {
+    if (worker.joinable()) worker.join();
+}
+
+bool Journal::compact_files() {
+    Metrics::Timer timer(Phase::Save);
+    // Last operation per roll, plus the order in which surviving rolls were first added.
+    unordered_map<string, string> last;
+    vector<string> order;
+    read_ops(frozen_file, base_id(csv_file), last, order);
+
+    string tmp = csv_file + ".compact.tmp";
+    {
+        ifstream base(csv_file);
+        ofstream out(tmp, ios::trunc);
+        if (!out.is_open()) return false;
+        string line;
+        while (getline(base, line)) {
+            if (last.count(ERPUtils::roll_text(line.substr(0, line.find(','))))) continue;
+            out << line << "\n";
+        }
+        for (auto &roll : order) if (!last[roll].empty()) out << last[roll] << "\n";
+        out.flush();
+        if (!out) return false;
+    }
+    if (!fsync_path(tmp)) return false;
+    {
+        // Recorded before the rename: operations logged since the freeze
+        // apply to the new base as well as to the old one plus the frozen file.
+        lock_guard<mutex> lk(mtx);
+        if (fd >= 0) note_base(base_id(tmp));
+    }
+    if (rename(tmp.c_str(), csv_file.c_str()) != 0) return false;
+    fsync_path(dir_of(csv_file), true);
+    // A snapshot older than the new base would never be loaded again, so
+    // rebuild it from the compacted records (save_snapshot renames into place).
+    string snap = ERPUtils::snapshot_path(csv_file);
+    if (file_exists(snap)) {
+        vector<Student> students;
+        ERPUtils::load_csv(csv_file, students);
+        ERPUtils::save_snapshot(students, snap);
+    }
+    unlink(frozen_file.c_str());
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Student.h"
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+// Append-only write-ahead journal kept next to the base CSV.
+// Each line is one operation keyed by roll number:
+//   A,<csv record>   add (replaces any record with the same roll)
+//   U,<csv record>   update (same effect as add)
+//   D,<roll>         delete every record with that roll
+//   B,<size>,<mtime> identity of a base CSV the operations apply to
+// A journal starts with the identity of the base it was opened against, and
+// one whose identities all differ from the current base (it was regenerated
+// or replaced) is ignored, then reset before the next operation is logged.
+// Because the final state of a roll depends only on its last operation,
+// replaying a journal twice is harmless, which makes compaction crash-safe:
+//   1. the live journal is renamed to <csv>.journal.compacting
+//   2. base + that file are folded into <csv>.compact.tmp, which is fsynced
+//   3. the temp file's identity is added to the live journal, whose
+//      operations apply on either base, and the temp file renamed over the base
+//   4. an existing <csv>.snap is rebuilt from the new base, then the frozen
+//      journal removed
+// A crash at any point leaves either the old base plus both journals or the
+// new base plus journals that re-apply cleanly; a snapshot left older than
+// the base is simply not used.
+class Journal {
+private:
+    string csv_file, journal_file, frozen_file;
+    mutable mutex mtx;
+    int fd = -1;
+    size_t ops = 0;
+    vector<string> bases; // identities recorded in the live journal
+    thread worker;
+    atomic<bool> running{false};
+
+    void append_line(const string &line);
+    void open_journal();
+    void note_base(const string &id);
+    bool compact_files();
+public:
+    static constexpr size_t COMPACT_THRESHOLD = 1024;
+
+    explicit Journal(string csv_file);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void log_add(const Student &s);
+    void log_update(const Student &s);
+    void log_delete(const RollID &r);
+
+    // Applies any frozen and live journal to a freshly loaded base; returns ops applied.
+    size_t replay(vector<Student> &students) const;
+    // What replay does to any base of csv_file, without opening the journal
+    // for writing: records whose roll is in dropped go, then added follows.
+    // Returns the operations read.
+    static size_t changes(const string &csv_file, unordered_set<string> &dropped, vector<Student> &added);
+
+    // Starts a background compaction unless one is already running.
+    void compact_async();
+    void wait();
+    bool compacting() const { return running; }
+    size_t pending_ops() const;
+};
+
+#endif
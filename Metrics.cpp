@@ -0,0 +1,197 @@
+#include "Metrics.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+namespace {
+const int NC = (int)Counter::COUNT;
+const int NP = (int)Phase::COUNT;
+
+struct Hist {
+    atomic<uint64_t> count, sum, max, buckets[Metrics::BUCKETS];
+};
+
+// Only the owning thread writes a shard, so updates are plain load + store.
+struct Shard {
+    atomic<uint64_t> counters[NC];
+    Hist phases[NP];
+};
+
+inline void bump(atomic<uint64_t> &a, uint64_t n) {
+    a.store(a.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// Shards of finished threads go to a free list and are handed to the next
+// new thread, keeping their totals; the registry is never destroyed because
+// threads may still record during static destruction.
+struct Registry {
+    mutex m;
+    vector<unique_ptr<Shard>> all;
+    vector<Shard*> spare;
+};
+
+// Allocations on threads without a shard yet. Kept outside the registry,
+// whose own construction allocates.
+atomic<uint64_t> unownedAllocs{0};
+
+Registry& registry() {
+    static Registry *r = new Registry;
+    return *r;
+}
+
+thread_local Shard *tlShard = nullptr;
+
+struct ShardRelease {
+    ~ShardRelease() {
+        if (!tlShard) return;
+        auto &r = registry();
+        lock_guard<mutex> lk(r.m);
+        r.spare.push_back(tlShard);
+        tlShard = nullptr;
+    }
+};
+
+Shard& local() {
+    if (!tlShard) {
+        thread_local ShardRelease release;
+        (void)release;
+        auto &r = registry();
+        lock_guard<mutex> lk(r.m);
+        if (!r.spare.empty()) {
+            tlShard = r.spare.back();
+            r.spare.pop_back();
+        } else {
+            r.all.push_back(unique_ptr<Shard>(new Shard()));
+            tlShard = r.all.back().get();
+        }
+    }
+    return *tlShard;
+}
+
+void count_alloc() {
+    if (tlShard) bump(tlShard->counters[(int)Counter::Allocations], 1);
+    else unownedAllocs.fetch_add(1, memory_order_relaxed);
+}
+}
+
+// Global allocation counting: every operator new goes through here.
+void* operator new(size_t n) {
+    count_alloc();
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void* operator new(size_t n, const nothrow_t&) noexcept {
+    count_alloc();
+    return malloc(n ? n : 1);
+}
+void* operator new[](size_t n, const nothrow_t&) noexcept { return operator new(n, nothrow); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void *p, const nothrow_t&) noexcept { free(p); }
+
+void Metrics::add(Counter c, uint64_t n) { bump(local().counters[(int)c], n); }
+
+void Metrics::record(Phase p, uint64_t ns) {
+    Hist &h = local().phases[(int)p];
+    bump(h.count, 1);
+    bump(h.sum, ns);
+    bump(h.buckets[bucket_of(ns)], 1);
+    if (ns > h.max.load(memory_order_relaxed)) h.max.store(ns, memory_order_relaxed);
+}
+
+// Values below 8 get a bucket each; above that, every power of two [2^e, 2^(e+1))
+// is split into 8 equal buckets by the 3 bits after the leading one.
+int Metrics::bucket_of(uint64_t ns) {
+    if (ns < (1u << SUB_BITS)) return (int)ns;
+    int e = 63 - __builtin_clzll(ns);
+    int sub = (int)(ns >> (e - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    return ((e - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+uint64_t Metrics::bucket_floor(int b) {
+    if (b < (1 << SUB_BITS)) return (uint64_t)b;
+    int e = (b >> SUB_BITS) + SUB_BITS - 1;
+    uint64_t sub = b & ((1 << SUB_BITS) - 1);
+    return ((1ull << SUB_BITS) | sub) << (e - SUB_BITS);
+}
+
+// Upper edge of the bucket holding the p-th percentile, capped at the maximum seen.
+uint64_t Metrics::Histogram::percentile_ns(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return b + 1 < BUCKETS ? min(max_ns, bucket_floor(b + 1) - 1) : max_ns;
+    }
+    return max_ns;
+}
+
+Metrics::Snapshot Metrics::snapshot() {
+    Snapshot s;
+    auto &r = registry();
+    lock_guard<mutex> lk(r.m);
+    s.counters[(int)Counter::Allocations] = unownedAllocs.load(memory_order_relaxed);
+    for (auto &sh : r.all) {
+        for (int c = 0; c < NC; ++c) s.counters[c] += sh->counters[c].load(memory_order_relaxed);
+        for (int p = 0; p < NP; ++p) {
+            const Hist &h = sh->phases[p];
+            Histogram &out = s.phases[p];
+            out.count += h.count.load(memory_order_relaxed);
+            out.sum_ns += h.sum.load(memory_order_relaxed);
+            out.max_ns = max(out.max_ns, h.max.load(memory_order_relaxed));
+            for (int b = 0; b < BUCKETS; ++b) out.buckets[b] += h.buckets[b].load(memory_order_relaxed);
+        }
+    }
+    return s;
+}
+
+const char* Metrics::name(Counter c) {
+    static const char *names[] = {"rows_parsed", "rows_rejected", "bytes_read", "allocations"};
+    return names[(int)c];
+}
+
+const char* Metrics::name(Phase p) {
+    static const char *names[] = {"load", "parse", "sort", "index_build", "query", "save"};
+    return names[(int)p];
+}
+
+string Metrics::Snapshot::to_text() const {
+    stringstream ss;
+    ss << left << setw(12) << "phase" << right << setw(10) << "count" << setw(12) << "total_ms"
+       << setw(12) << "p50_us" << setw(12) << "p99_us" << setw(12) << "max_us" << "\n";
+    ss << fixed << setprecision(1);
+    for (int p = 0; p < NP; ++p) {
+        const Histogram &h = phases[p];
+        ss << left << setw(12) << name((Phase)p) << right << setw(10) << h.count << setw(12) << h.sum_ns / 1e6
+           << setw(12) << h.percentile_ns(50) / 1e3 << setw(12) << h.percentile_ns(99) / 1e3
+           << setw(12) << h.max_ns / 1e3 << "\n";
+    }
+    for (int c = 0; c < NC; ++c) ss << left << setw(14) << name((Counter)c) << counters[c] << "\n";
+    return ss.str();
+}
+
+string Metrics::Snapshot::to_json() const {
+    stringstream ss;
+    ss << "{\n  \"counters\": {";
+    for (int c = 0; c < NC; ++c)
+        ss << (c ? ", " : "") << "\"" << name((Counter)c) << "\": " << counters[c];
+    ss << "},\n  \"phases\": {";
+    for (int p = 0; p < NP; ++p) {
+        const Histogram &h = phases[p];
+        ss << (p ? "," : "") << "\n    \"" << name((Phase)p) << "\": {\"count\": " << h.count
+           << ", \"total_ns\": " << h.sum_ns << ", \"p50_ns\": " << h.percentile_ns(50)
+           << ", \"p99_ns\": " << h.percentile_ns(99) << ", \"max_ns\": " << h.max_ns << "}";
+    }
+    ss << "\n  }\n}\n";
+    return ss.str();
+}
@@ -0,0 +1,58 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+enum class Counter { RowsParsed, RowsRejected, BytesRead, Allocations, COUNT };
+enum class Phase { Load, Parse, Sort, IndexBuild, Query, Save, COUNT };
+
+// Process-wide hot-path metrics. Each thread records into its own shard of
+// relaxed atomics that only it writes, so recording takes no lock and shares
+// no cache lines; snapshot() sums the shards. Phase latencies go into
+// log-linear histograms: 8 linear buckets per power of two nanoseconds.
+class Metrics {
+public:
+    static const int SUB_BITS = 3;
+    static const int BUCKETS = 64 << SUB_BITS;
+
+    struct Histogram {
+        uint64_t count = 0, sum_ns = 0, max_ns = 0;
+        vector<uint64_t> buckets = vector<uint64_t>(BUCKETS, 0);
+        uint64_t percentile_ns(double p) const;
+    };
+    struct Snapshot {
+        uint64_t counters[(int)Counter::COUNT] = {};
+        Histogram phases[(int)Phase::COUNT];
+        string to_text() const;
+        string to_json() const;
+    };
+
+    static void add(Counter c, uint64_t n = 1);
+    static void record(Phase p, uint64_t ns);
+    static Snapshot snapshot();
+    static const char* name(Counter c);
+    static const char* name(Phase p);
+    static int bucket_of(uint64_t ns);
+    static uint64_t bucket_floor(int b);
+
+    // Records the lifetime of the scope under a phase.
+    class Timer {
+    private:
+        Phase phase;
+        chrono::steady_clock::time_point start;
+    public:
+        explicit Timer(Phase p) : phase(p), start(chrono::steady_clock::now()) {}
+        ~Timer() {
+            record(phase, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+};
+
+#endif
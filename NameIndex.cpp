@@ -0,0 +1,329 @@
+#include "NameIndex.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+const uint32_t NONE = UINT32_MAX;
+
+// Distinct trigrams of the word padded with a space on each side, so short
+// words still have one and the ends of a word weigh in.
+vector<uint32_t> trigrams(const string &word) {
+    string p = " " + word + " ";
+    vector<uint32_t> out;
+    for (size_t i = 0; i + 3 <= p.size(); ++i)
+        out.push_back((uint32_t)(unsigned char)p[i] << 16 | (uint32_t)(unsigned char)p[i + 1] << 8 | (unsigned char)p[i + 2]);
+    sort(out.begin(), out.end());
+    out.erase(unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+vector<string> split_words(const string &text) {
+    vector<string> out;
+    size_t b = 0;
+    while (b < text.size()) {
+        size_t e = text.find(' ', b);
+        if (e == string::npos) e = text.size();
+        out.push_back(text.substr(b, e - b));
+        b = e + 1;
+    }
+    return out;
+}
+
+// Levenshtein distance, or limit + 1 once it must exceed limit.
+int bounded_distance(string_view a, string_view b, int limit) {
+    if ((int)a.size() - (int)b.size() > limit || (int)b.size() - (int)a.size() > limit) return limit + 1;
+    vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = (int)j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        int diag = row[0], best = row[0] = (int)i;
+        for (size_t j = 1; j <= b.size(); ++j) {
+            int up = row[j];
+            row[j] = min({up + 1, row[j - 1] + 1, diag + (a[i - 1] != b[j - 1])});
+            diag = up;
+            best = min(best, row[j]);
+        }
+        if (best > limit) return limit + 1;
+    }
+    return min(row[b.size()], limit + 1);
+}
+}
+
+string NameIndex::normalize(const string &name) {
+    string out;
+    bool space = false;
+    for (char c : name) {
+        if (isspace((unsigned char)c)) { space = !out.empty(); continue; }
+        if (space) out += ' ';
+        space = false;
+        out += (char)tolower((unsigned char)c);
+    }
+    return out;
+}
+
+uint32_t NameIndex::intern(const string &text, bool &added) {
+    auto it = nameIds.find(text);
+    added = it == nameIds.end();
+    if (!added) return it->second;
+    uint32_t id = (uint32_t)names.size();
+    names.push_back({text, {}, {}});
+    nameIds.emplace(text, id);
+    return id;
+}
+
+// Adds a new name's word starts and words. Once build_from has sorted them,
+// everything stays in text order; a new name shifts the ranks after it.
+void NameIndex::index_name(uint32_t id) {
+    const string &t = names[id].text;
+    rank.push_back(0);
+    if (students) {
+        auto at = upper_bound(byText.begin(), byText.end(), id, [&](uint32_t a, uint32_t b) { return names[a].text < names[b].text; });
+        at = byText.insert(at, id);
+        for (size_t i = at - byText.begin(); i < byText.size(); ++i) rank[byText[i]] = (uint32_t)i;
+    } else {
+        byText.push_back(id);
+    }
+    for (uint32_t pos = 0; pos < t.size(); ++pos) {
+        if (pos > 0 && t[pos - 1] != ' ') continue;
+        Start s{id, pos};
+        if (students) {
+            auto at = upper_bound(starts.begin(), starts.end(), s, [&](const Start &a, const Start &b) { return suffix(a) < suffix(b); });
+            starts.insert(at, s);
+        } else {
+            starts.push_back(s);
+        }
+    }
+    for (auto &w : split_words(t)) {
+        auto it = wordIds.find(w);
+        if (it == wordIds.end()) {
+            uint32_t wid = (uint32_t)words.size();
+            it = wordIds.emplace(w, wid).first;
+            words.push_back(w);
+            wordNames.emplace_back();
+            for (uint32_t g : trigrams(w)) grams[g].push_back(wid);
+        }
+        auto &own = names[id].words;
+        if (find(own.begin(), own.end(), it->second) != own.end()) continue;
+        own.push_back(it->second);
+        auto &postings = wordNames[it->second];
+        if (students) postings.insert(upper_bound(postings.begin(), postings.end(), id, by_rank()), id);
+        else postings.push_back(id);
+    }
+}
+
+void NameIndex::build_from(const vector<Student> &students) {
+    this->students = nullptr;
+    names.clear();
+    nameIds.clear();
+    byText.clear();
+    rank.clear();
+    starts.clear();
+    words.clear();
+    wordIds.clear();
+    wordNames.clear();
+    grams.clear();
+    nameOf.assign(students.size(), NONE);
+    for (uint32_t i = 0; i < students.size(); ++i) {
+        bool added;
+        uint32_t id = intern(normalize(students[i].get_name()), added);
+        if (added) index_name(id);
+        names[id].students.push_back(i);
+        nameOf[i] = id;
+    }
+    stable_sort(starts.begin(), starts.end(), [&](const Start &a, const Start &b) { return suffix(a) < suffix(b); });
+    sort(byText.begin(), byText.end(), [&](uint32_t a, uint32_t b) { return names[a].text < names[b].text; });
+    for (uint32_t i = 0; i < byText.size(); ++i) rank[byText[i]] = i;
+    for (auto &postings : wordNames) sort(postings.begin(), postings.end(), by_rank());
+    this->students = &students;
+}
+
+void NameIndex::insert(uint32_t student) {
+    if (!students) return;
+    if (nameOf.size() <= student) nameOf.resize(student + 1, NONE);
+    bool added;
+    uint32_t id = intern(normalize((*students)[student].get_name()), added);
+    if (added) index_name(id);
+    names[id].students.push_back(student);
+    nameOf[student] = id;
+}
+
+void NameIndex::erase(uint32_t student) {
+    if (student >= nameOf.size() || nameOf[student] == NONE) return;
+    auto &list = names[nameOf[student]].students;
+    auto it = find(list.begin(), list.end(), student);
+    if (it != list.end()) { *it = list.back(); list.pop_back(); }
+    nameOf[student] = NONE;
+}
+
+void NameIndex::relocate(uint32_t from, uint32_t to) {
+    if (from >= nameOf.size() || nameOf[from] == NONE) return;
+    if (nameOf.size() <= to) nameOf.resize(to + 1, NONE);
+    auto &list = names[nameOf[from]].students;
+    replace(list.begin(), list.end(), from, to);
+    nameOf[to] = nameOf[from];
+    nameOf[from] = NONE;
+}
+
+void NameIndex::append(vector<uint32_t> &out, uint32_t name, size_t limit) const {
+    vector<uint32_t> list = names[name].students;
+    sort(list.begin(), list.end());
+    for (uint32_t s : list) {
+        if (limit && out.size() >= limit) return;
+        out.push_back(s);
+    }
+}
+
+vector<uint32_t> NameIndex::prefix(const string &query, size_t limit) const {
+    vector<uint32_t> out;
+    string q = normalize(query);
+    if (q.empty()) return out;
+    auto it = lower_bound(starts.begin(), starts.end(), q, [&](const Start &s, const string &v) { return suffix(s) < v; });
+    unordered_set<uint32_t> seen;
+    for (; it != starts.end() && (!limit || out.size() < limit); ++it) {
+        string_view sv = suffix(*it);
+        if (sv.compare(0, q.size(), q) != 0) break;
+        // A name can match at several word starts; list it once.
+        if (!seen.insert(it->name).second) continue;
+        append(out, it->name, limit);
+    }
+    return out;
+}
+
+// Vocabulary words within max_distance of word, as (word id, distance) by id.
+// Each edit touches at most three trigrams, so a match shares at least `need`
+// of the word's trigrams and must appear in one of the (lists - need + 1)
+// shortest posting lists.
+vector<pair<uint32_t, int>> NameIndex::close_words(const string &word, int max_distance) const {
+    static const vector<uint32_t> empty;
+    vector<const vector<uint32_t>*> lists;
+    for (uint32_t g : trigrams(word)) {
+        auto it = grams.find(g);
+        lists.push_back(it == grams.end() ? &empty : &it->second);
+    }
+    sort(lists.begin(), lists.end(), [](auto *a, auto *b) { return a->size() < b->size(); });
+    size_t need = max<int>(1, (int)lists.size() - 3 * max_distance);
+    vector<uint32_t> cand;
+    for (size_t i = 0; i + need <= lists.size(); ++i)
+        for (uint32_t c : *lists[i])
+            if (words[c].size() + max_distance >= word.size() && words[c].size() <= word.size() + max_distance) cand.push_back(c);
+    sort(cand.begin(), cand.end());
+    cand.erase(unique(cand.begin(), cand.end()), cand.end());
+
+    vector<pair<uint32_t, int>> out;
+    for (uint32_t c : cand) {
+        size_t shared = 0;
+        for (auto *l : lists) shared += binary_search(l->begin(), l->end(), c);
+        if (shared < need) continue;
+        int d = bounded_distance(word, words[c], max_distance);
+        if (d <= max_distance) out.push_back({c, d});
+    }
+    return out;
+}
+
+// Walks the union of several posting lists in text order: seek(r) moves to
+// the first name ranked r or later and reports it with the smallest
+// distance among the lists holding it.
+struct NameIndex::Cursor {
+    struct Run {
+        const uint32_t *at, *end;
+        int distance;
+    };
+    const vector<uint32_t> &rank;
+    vector<Run> runs;
+
+    bool seek(uint32_t r, uint32_t &name, int &distance) {
+        bool found = false;
+        for (auto &run : runs) {
+            // gallop, then binary search the last step
+            size_t step = 1;
+            while (run.at + step < run.end && rank[run.at[step]] < r) { run.at += step; step <<= 1; }
+            run.at = lower_bound(run.at, min(run.end, run.at + step + 1), r,
+                                 [&](uint32_t n, uint32_t v) { return rank[n] < v; });
+            if (run.at == run.end) continue;
+            uint32_t n = *run.at;
+            if (!found || rank[n] < rank[name] || (n == name && run.distance < distance)) {
+                name = n;
+                distance = run.distance;
+                found = true;
+            }
+        }
+        return found;
+    }
+};
+
+// Cursor over the names of the close words at distance `tier` (all if tier < 0).
+NameIndex::Cursor NameIndex::near(const vector<pair<uint32_t, int>> &close, int tier) const {
+    Cursor c{rank, {}};
+    for (auto &w : close)
+        if ((tier < 0 || w.second == tier) && !wordNames[w.first].empty())
+            c.runs.push_back({wordNames[w.first].data(), wordNames[w.first].data() + wordNames[w.first].size(), w.second});
+    return c;
+}
+
+vector<uint32_t> NameIndex::fuzzy(const string &query, size_t limit, int max_distance) const {
+    vector<uint32_t> out;
+    string q = normalize(query);
+    if (q.empty()) return out;
+    if (max_distance < 0) max_distance = min(2, (int)q.size() / 4);
+
+    vector<vector<pair<uint32_t, int>>> close;
+    for (auto &w : split_words(q)) {
+        close.push_back(close_words(w, max_distance));
+        if (close.back().empty()) return out;
+    }
+    auto emit = [&](uint32_t n) {
+        if (!names[n].students.empty()) append(out, n, limit);
+    };
+    uint32_t name;
+    int d;
+
+    if (close.size() == 1) {
+        // One word: tiers come out closest first and in text order, so the
+        // scan stops as soon as the limit is reached.
+        unordered_set<uint32_t> seen;
+        for (int t = 0; t <= max_distance && !(limit && out.size() >= limit); ++t) {
+            Cursor c = near(close[0], t);
+            for (uint32_t r = 0; !(limit && out.size() >= limit) && c.seek(r, name, d); r = rank[name] + 1)
+                if (seen.insert(name).second) emit(name);
+        }
+        return out;
+    }
+
+    // Several words: leapfrog join of the per-word name lists (all in text
+    // order), so only the names holding every word are visited.
+    vector<Cursor> cursors;
+    for (auto &c : close) cursors.push_back(near(c, -1));
+    vector<pair<int, uint32_t>> hits;
+    uint32_t r = 0;
+    while (true) {
+        int total = 0;
+        bool aligned = true, done = false;
+        for (auto &c : cursors) {
+            if (!c.seek(r, name, d)) { done = true; break; }
+            if (rank[name] != r) { r = rank[name]; aligned = false; break; }
+            total += d;
+        }
+        if (done) break;
+        if (!aligned) continue;
+        if (total <= max_distance) hits.push_back({total, name});
+        ++r;
+    }
+    // stable: equal distances keep text order
+    stable_sort(hits.begin(), hits.end(), [](auto &a, auto &b) { return a.first < b.first; });
+    for (auto &h : hits) {
+        if (limit && out.size() >= limit) break;
+        emit(h.second);
+    }
+    return out;
+}
+
+vector<uint32_t> NameIndex::search(const string &query, size_t limit) const {
+    vector<uint32_t> out = prefix(query, limit);
+    if (limit && out.size() >= limit) return out;
+    vector<uint32_t> listed = out;
+    sort(listed.begin(), listed.end());
+    for (uint32_t s : fuzzy(query, limit ? limit + out.size() : 0)) {
+        if (limit && out.size() >= limit) break;
+        if (!binary_search(listed.begin(), listed.end(), s)) out.push_back(s);
+    }
+    return out;
+}
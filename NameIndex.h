@@ -0,0 +1,73 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include "Student.h"
+#include <vector>
+#include <unordered_map>
+
+// Name search. Names are normalized (ASCII lower case, single spaces) and
+// interned, so each distinct name is indexed once however many students
+// share it. Prefix search binary-searches a sorted array holding every word
+// start of every distinct name ("meh" finds "Advait Mehta"). Fuzzy search
+// works on distinct words: a trigram inverted index over the word
+// vocabulary finds the close spellings of each query word, and a name
+// matches when every query word is close to one of its words.
+// Like RollIndex, entries refer to students by index and follow adds and
+// deletes with insert/erase/relocate.
+class NameIndex {
+private:
+    struct Name {
+        string text;               // normalized
+        vector<uint32_t> words;    // distinct word ids
+        vector<uint32_t> students;
+    };
+    struct Start {                 // a word start within a name
+        uint32_t name;
+        uint32_t pos;
+    };
+    vector<Name> names;                               // append-only; ids never change
+    unordered_map<string, uint32_t> nameIds;
+    vector<uint32_t> byText;                          // name ids in text order
+    vector<uint32_t> rank;                            // name id -> position in byText
+    vector<Start> starts;                             // sorted by the text from pos
+    vector<string> words;
+    unordered_map<string, uint32_t> wordIds;
+    vector<vector<uint32_t>> wordNames;               // word id -> name ids, in text order
+    unordered_map<uint32_t, vector<uint32_t>> grams;  // trigram -> word ids (ascending)
+    vector<uint32_t> nameOf;                          // student -> name id
+    const vector<Student> *students = nullptr;
+
+    string_view suffix(const Start &s) const { return string_view(names[s.name].text).substr(s.pos); }
+    auto by_rank() const { return [this](uint32_t a, uint32_t b) { return rank[a] < rank[b]; }; }
+    uint32_t intern(const string &text, bool &added);
+    void index_name(uint32_t id);
+    vector<pair<uint32_t, int>> close_words(const string &word, int max_distance) const;
+    struct Cursor;
+    Cursor near(const vector<pair<uint32_t, int>> &close, int tier) const;
+    void append(vector<uint32_t> &out, uint32_t name, size_t limit) const;
+public:
+    static string normalize(const string &name);
+
+    void build_from(const vector<Student> &students);
+    // Points a copy of the index at a copy of the vector it was built over.
+    void rebind(const vector<Student> &copy) { if (students) students = &copy; }
+    // Adds students[student] (e.g. after a push_back).
+    void insert(uint32_t student);
+    // Removes students[student]; the name is taken from the index, so this may follow a change.
+    void erase(uint32_t student);
+    // Repoints the entry of students[from] at index `to` (swap-and-pop).
+    void relocate(uint32_t from, uint32_t to);
+
+    // Students whose name has a word starting with the query (which may span
+    // words, e.g. "advait me"), ordered by the matching text; at most limit (0 = all).
+    vector<uint32_t> prefix(const string &query, size_t limit = 0) const;
+    // Students whose names have a word within reach of every query word, with
+    // at most max_distance edits in total; closest first, then by name. The
+    // default allows one edit per four characters of the query, at most two.
+    vector<uint32_t> fuzzy(const string &query, size_t limit = 0, int max_distance = -1) const;
+    // Prefix matches, then fuzzy matches not already listed.
+    vector<uint32_t> search(const string &query, size_t limit) const;
+    size_t distinct_names() const { return nameIds.size(); }
+};
+
+#endif
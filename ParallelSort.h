@@ -0,0 +1,133 @@
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include "ThreadPool.h"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+#include <cstdint>
+
+using namespace std;
+
+// Per-thread busy time of a parallel sort: thread_ms[0] is the calling thread,
+// thread_ms[1..] the pool workers.
+struct SortTimings {
+    vector<long long> thread_ms;
+    long long sort_ms = 0;
+    long long merge_ms = 0;
+    long long total_ms = 0;
+};
+
+namespace ParallelSort {
+using clk = chrono::steady_clock;
+
+// Sorts v on the pool: runs of ~grain elements are sorted by tasks spawned
+// through recursive splitting, then merged by a parallel multiway merge in
+// which each task produces one independent slice of the output.
+template <typename T, typename Comp>
+void sort(vector<T> &v, Comp comp, ThreadPool &pool, SortTimings *timings = nullptr) {
+    auto t0 = clk::now();
+    size_t n = v.size();
+    unsigned P = pool.concurrency();
+    vector<long long> busy(P, 0); // microseconds; each slot written by one thread only
+    auto timed = [&](auto &&fn) {
+        auto st = clk::now();
+        fn();
+        busy[pool.current_slot()] += chrono::duration_cast<chrono::microseconds>(clk::now() - st).count();
+    };
+
+    // Run boundaries: about 4 runs per thread so stealing can even out the load.
+    size_t runs = (P == 1 || n < 16384) ? 1 : min<size_t>(P * 4, n / 4096);
+    vector<size_t> bounds(runs + 1);
+    for (size_t r = 0; r <= runs; ++r) bounds[r] = n * r / runs;
+
+    {
+        TaskGroup g(pool);
+        function<void(size_t, size_t)> split = [&](size_t lo, size_t hi) {
+            while (hi - lo > 1) {
+                size_t mid = (lo + hi) / 2;
+                g.run([&split, mid, hi]() { split(mid, hi); });
+                hi = mid;
+            }
+            timed([&]() { std::sort(v.begin() + bounds[lo], v.begin() + bounds[lo + 1], comp); });
+        };
+        split(0, runs);
+        g.wait();
+    }
+    auto t1 = clk::now();
+
+    if (runs > 1) {
+        // Splitters from a regular sample of every run; equal keys always land in
+        // the same slice because every run is cut with lower_bound.
+        size_t slices = runs;
+        vector<T> sample;
+        for (size_t r = 0; r < runs; ++r)
+            for (size_t s = 1; s < slices; ++s)
+                sample.push_back(v[bounds[r] + (bounds[r + 1] - bounds[r]) * s / slices]);
+        std::sort(sample.begin(), sample.end(), comp);
+        vector<T> splitters;
+        for (size_t s = 1; s < slices; ++s) splitters.push_back(sample[sample.size() * s / slices]);
+
+        // cut[s][r]: start of slice s within run r; offset[s]: where slice s begins in the output.
+        vector<vector<size_t>> cut(slices + 1, vector<size_t>(runs));
+        for (size_t r = 0; r < runs; ++r) {
+            cut[0][r] = bounds[r];
+            cut[slices][r] = bounds[r + 1];
+            for (size_t s = 1; s < slices; ++s)
+                cut[s][r] = lower_bound(v.begin() + cut[s - 1][r], v.begin() + bounds[r + 1], splitters[s - 1], comp) - v.begin();
+        }
+        vector<size_t> offset(slices + 1, 0);
+        for (size_t s = 0; s < slices; ++s) {
+            offset[s + 1] = offset[s];
+            for (size_t r = 0; r < runs; ++r) offset[s + 1] += cut[s + 1][r] - cut[s][r];
+        }
+
+        vector<T> out(n);
+        TaskGroup g(pool);
+        for (size_t s = 0; s < slices; ++s) {
+            g.run([&, s]() {
+                timed([&]() {
+                    // k-way merge of this slice through a min-heap of run heads.
+                    vector<size_t> pos(cut[s]), end(cut[s + 1]);
+                    auto later = [&](size_t a, size_t b) { return comp(v[pos[b]], v[pos[a]]); };
+                    vector<size_t> heap;
+                    for (size_t r = 0; r < runs; ++r) if (pos[r] < end[r]) heap.push_back(r);
+                    make_heap(heap.begin(), heap.end(), later);
+                    size_t o = offset[s];
+                    while (!heap.empty()) {
+                        pop_heap(heap.begin(), heap.end(), later);
+                        size_t r = heap.back();
+                        out[o++] = move(v[pos[r]++]);
+                        if (pos[r] < end[r]) push_heap(heap.begin(), heap.end(), later);
+                        else heap.pop_back();
+                    }
+                });
+            });
+        }
+        g.wait();
+        v.swap(out);
+    }
+
+    if (timings) {
+        auto t2 = clk::now();
+        timings->thread_ms.assign(P, 0);
+        for (unsigned i = 0; i < P; ++i) timings->thread_ms[i] = busy[i] / 1000;
+        timings->sort_ms = chrono::duration_cast<chrono::milliseconds>(t1 - t0).count();
+        timings->merge_ms = chrono::duration_cast<chrono::milliseconds>(t2 - t1).count();
+        timings->total_ms = chrono::duration_cast<chrono::milliseconds>(t2 - t0).count();
+    }
+}
+
+// The first 16 bytes of s packed big-endian into two integers, zero padded,
+// so comparing the pairs orders strings as compare does, up to ties.
+inline void pack_prefix(string_view s, uint64_t (&out)[2]) {
+    for (size_t w = 0; w < 2; ++w) {
+        uint64_t v = 0;
+        for (size_t i = w * 8; i < w * 8 + 8; ++i) v = (v << 8) | (i < s.size() ? (unsigned char)s[i] : 0);
+        out[w] = v;
+    }
+}
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "QueryEngine.h"
+#include "ERPUtils.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace std;
+
+// Parsing
+namespace {
+const Grade INF = numeric_limits<Grade>::infinity();
+
+struct Parser {
+    vector<string> toks;
+    size_t pos = 0;
+    string error;
+
+    static bool is_op_char(char c) { return c == '(' || c == ')' || c == '&' || c == '|' || c == '!' || c == '<' || c == '>' || c == '='; }
+
+    void tokenize(const string &s) {
+        for (size_t i = 0; i < s.size();) {
+            char c = s[i];
+            if (isspace((unsigned char)c)) { ++i; continue; }
+            if ((c == '<' || c == '>') && i + 1 < s.size() && s[i + 1] == '=') { toks.push_back(s.substr(i, 2)); i += 2; continue; }
+            if (is_op_char(c)) { toks.push_back(string(1, c)); ++i; continue; }
+            size_t j = i;
+            while (j < s.size() && !isspace((unsigned char)s[j]) && !is_op_char(s[j])) ++j;
+            toks.push_back(s.substr(i, j - i));
+            i = j;
+        }
+    }
+
+    const string& peek() const { static const string none; return pos < toks.size() ? toks[pos] : none; }
+    static string upper(string s) { for (auto &c : s) c = (char)toupper((unsigned char)c); return s; }
+    bool accept_keyword(const string &kw, const string &sym) {
+        if (pos < toks.size() && (upper(toks[pos]) == kw || toks[pos] == sym)) { ++pos; return true; }
+        return false;
+    }
+    static void reset(QueryExpr &e, QueryExpr::Kind k) {
+        e.kind = k;
+        e.children.clear();
+    }
+    bool fail(const string &msg) { if (error.empty()) error = msg; return false; }
+
+    static bool number(const string &s, Grade &out) {
+        if (s.empty()) return false;
+        char *end = nullptr;
+        out = strtod(s.c_str(), &end);
+        return *end == '\0';
+    }
+
+    bool parse_or(QueryExpr &out) {
+        QueryExpr first;
+        if (!parse_and(first)) return false;
+        if (upper(peek()) != "OR" && peek() != "|") { out = move(first); return true; }
+        reset(out, QueryExpr::OR);
+        out.children.push_back(move(first));
+        while (accept_keyword("OR", "|")) {
+            out.children.emplace_back();
+            if (!parse_and(out.children.back())) return false;
+        }
+        return true;
+    }
+
+    bool parse_and(QueryExpr &out) {
+        QueryExpr first;
+        if (!parse_not(first)) return false;
+        if (upper(peek()) != "AND" && peek() != "&") { out = move(first); return true; }
+        reset(out, QueryExpr::AND);
+        out.children.push_back(move(first));
+        while (accept_keyword("AND", "&")) {
+            out.children.emplace_back();
+            if (!parse_not(out.children.back())) return false;
+        }
+        return true;
+    }
+
+    bool parse_not(QueryExpr &out) {
+        if (accept_keyword("NOT", "!")) {
+            reset(out, QueryExpr::NOT);
+            out.children.emplace_back();
+            return parse_not(out.children.back());
+        }
+        if (peek() == "(") {
+            ++pos;
+            if (!parse_or(out)) return false;
+            if (peek() != ")") return fail("expected ')'");
+            ++pos;
+            return true;
+        }
+        return parse_pred(out);
+    }
+
+    bool parse_pred(QueryExpr &out) {
+        string code = peek();
+        string kw = upper(code);
+        if (code.empty()) return fail("unexpected end of query");
+        if (is_op_char(code[0]) || kw == "AND" || kw == "OR" || kw == "NOT") return fail("expected a course code, got '" + code + "'");
+        ++pos;
+        reset(out, QueryExpr::PRED);
+        out.course = ERPUtils::parse_course_id(code);
+        out.lo = -INF;
+        out.hi = INF;
+        string op = peek();
+        if (op != ">=" && op != ">" && op != "<=" && op != "<" && op != "=") return true;
+        ++pos;
+        string arg = peek();
+        ++pos;
+        Grade g = 0;
+        if (op == "=" && arg.find("..") != string::npos) {
+            size_t dots = arg.find("..");
+            if (!number(arg.substr(0, dots), out.lo) || !number(arg.substr(dots + 2), out.hi))
+                return fail("bad grade range '" + arg + "'");
+            return true;
+        }
+        if (!number(arg, g)) return fail("bad grade '" + arg + "' after " + op);
+        if (op == ">=") out.lo = g;
+        else if (op == ">") out.lo = nextafter(g, INF);
+        else if (op == "<=") out.hi = g;
+        else if (op == "<") out.hi = nextafter(g, -INF);
+        else out.lo = out.hi = g;
+        return true;
+    }
+};
+}
+
+bool QueryExpr::parse(const string &text, QueryExpr &out, string *error) {
+    Parser p;
+    p.tokenize(text);
+    bool ok = p.parse_or(out);
+    if (ok && p.pos < p.toks.size()) ok = p.fail("unexpected '" + p.toks[p.pos] + "'");
+    if (!ok && error) *error = p.error;
+    return ok;
+}
+
+// Evaluation
+namespace {
+struct IdSet {
+    bool dense = false;
+    vector<uint32_t> ids;  // sparse: ascending student indices
+    vector<uint64_t> bits; // dense: one bit per student
+};
+
+size_t words_for(size_t n) { return (n + 63) / 64; }
+
+size_t count(const IdSet &s) {
+    if (!s.dense) return s.ids.size();
+    size_t c = 0;
+    for (uint64_t w : s.bits) c += __builtin_popcountll(w);
+    return c;
+}
+
+bool worth_dense(size_t k, size_t n) { return k * 32 > n; }
+
+void make_dense(IdSet &s, size_t n) {
+    if (s.dense) return;
+    s.bits.assign(words_for(n), 0);
+    for (uint32_t id : s.ids) s.bits[id >> 6] |= 1ull << (id & 63);
+    s.ids = vector<uint32_t>();
+    s.dense = true;
+}
+
+void make_sparse(IdSet &s) {
+    if (!s.dense) return;
+    s.ids.clear();
+    for (size_t w = 0; w < s.bits.size(); ++w)
+        for (uint64_t b = s.bits[w]; b; b &= b - 1) s.ids.push_back((uint32_t)(w * 64 + __builtin_ctzll(b)));
+    s.bits = vector<uint64_t>();
+    s.dense = false;
+}
+
+bool test(const IdSet &s, uint32_t id) { return (s.bits[id >> 6] >> (id & 63)) & 1; }
+
+// First position at or after from whose value is >= x: probe 1, 2, 4, ...
+// elements ahead, then binary search the last gap.
+size_t gallop(const vector<uint32_t> &v, size_t from, uint32_t x) {
+    if (from >= v.size() || v[from] >= x) return from;
+    size_t lo = from, step = 1; // v[lo] < x
+    while (lo + step < v.size() && v[lo + step] < x) { lo += step; step <<= 1; }
+    size_t hi = min(lo + step + 1, v.size());
+    return lower_bound(v.begin() + lo + 1, v.begin() + hi, x) - v.begin();
+}
+
+IdSet leaf(const CourseIndex &idx, const QueryExpr &q, size_t n) {
+    IdSet s;
+    auto [first, last] = idx.grade_range(q.course, q.lo, q.hi);
+    size_t k = last - first;
+    if (worth_dense(k, n)) {
+        s.dense = true;
+        s.bits.assign(words_for(n), 0);
+        for (const Posting *p = first; p != last; ++p) s.bits[p->student >> 6] |= 1ull << (p->student & 63);
+    } else {
+        s.ids.reserve(k);
+        for (const Posting *p = first; p != last; ++p) s.ids.push_back(p->student);
+        sort(s.ids.begin(), s.ids.end());
+    }
+    return s;
+}
+
+IdSet universe(size_t n) {
+    IdSet s;
+    s.dense = true;
+    s.bits.assign(words_for(n), ~0ull);
+    if (n % 64) s.bits.back() = (1ull << (n % 64)) - 1;
+    return s;
+}
+
+void intersect(IdSet &a, const IdSet &b) {
+    if (a.dense && b.dense) {
+        for (size_t w = 0; w < a.bits.size(); ++w) a.bits[w] &= b.bits[w];
+    } else if (a.dense) {
+        IdSet r;
+        for (uint32_t id : b.ids) if (test(a, id)) r.ids.push_back(id);
+        a = move(r);
+    } else if (b.dense) {
+        a.ids.erase(remove_if(a.ids.begin(), a.ids.end(), [&](uint32_t id) { return !test(b, id); }), a.ids.end());
+    } else {
+        // Probe the larger list for each element of the smaller one.
+        const vector<uint32_t> &small = a.ids.size() <= b.ids.size() ? a.ids : b.ids;
+        const vector<uint32_t> &large = a.ids.size() <= b.ids.size() ? b.ids : a.ids;
+        vector<uint32_t> r;
+        size_t pos = 0;
+        for (uint32_t id : small) {
+            pos = gallop(large, pos, id);
+            if (pos == large.size()) break;
+            if (large[pos] == id) r.push_back(id);
+        }
+        a.ids.swap(r);
+    }
+}
+
+void subtract(IdSet &a, const IdSet &b) {
+    if (a.dense && b.dense) {
+        for (size_t w = 0; w < a.bits.size(); ++w) a.bits[w] &= ~b.bits[w];
+    } else if (a.dense) {
+        for (uint32_t id : b.ids) a.bits[id >> 6] &= ~(1ull << (id & 63));
+    } else if (b.dense) {
+        a.ids.erase(remove_if(a.ids.begin(), a.ids.end(), [&](uint32_t id) { return test(b, id); }), a.ids.end());
+    } else {
+        size_t pos = 0;
+        a.ids.erase(remove_if(a.ids.begin(), a.ids.end(), [&](uint32_t id) {
+            pos = gallop(b.ids, pos, id);
+            return pos < b.ids.size() && b.ids[pos] == id;
+        }), a.ids.end());
+    }
+}
+
+void unite(IdSet &a, IdSet &&b, size_t n) {
+    if (!a.dense && !b.dense && !worth_dense(a.ids.size() + b.ids.size(), n)) {
+        vector<uint32_t> r;
+        r.reserve(a.ids.size() + b.ids.size());
+        set_union(a.ids.begin(), a.ids.end(), b.ids.begin(), b.ids.end(), back_inserter(r));
+        a.ids.swap(r);
+        return;
+    }
+    make_dense(a, n);
+    if (b.dense) for (size_t w = 0; w < a.bits.size(); ++w) a.bits[w] |= b.bits[w];
+    else for (uint32_t id : b.ids) a.bits[id >> 6] |= 1ull << (id & 63);
+}
+
+IdSet eval(const CourseIndex &idx, const QueryExpr &q, size_t n) {
+    switch (q.kind) {
+    case QueryExpr::PRED:
+        return leaf(idx, q, n);
+    case QueryExpr::NOT: {
+        IdSet s = universe(n);
+        subtract(s, eval(idx, q.children[0], n));
+        return s;
+    }
+    case QueryExpr::OR: {
+        IdSet s = eval(idx, q.children[0], n);
+        for (size_t i = 1; i < q.children.size(); ++i) unite(s, eval(idx, q.children[i], n), n);
+        return s;
+    }
+    case QueryExpr::AND: {
+        // Intersect the positive operands smallest first, then subtract the negated ones.
+        vector<IdSet> pos;
+        vector<const QueryExpr*> neg;
+        for (auto &c : q.children) {
+            if (c.kind == QueryExpr::NOT) neg.push_back(&c.children[0]);
+            else pos.push_back(eval(idx, c, n));
+        }
+        vector<pair<size_t, size_t>> order;
+        for (size_t i = 0; i < pos.size(); ++i) order.push_back({count(pos[i]), i});
+        sort(order.begin(), order.end());
+        IdSet s = pos.empty() ? universe(n) : move(pos[order[0].second]);
+        for (size_t i = 1; i < order.size() && count(s) > 0; ++i) intersect(s, pos[order[i].second]);
+        for (auto *c : neg) {
+            if (count(s) == 0) break;
+            subtract(s, eval(idx, *c, n));
+        }
+        return s;
+    }
+    }
+    return IdSet();
+}
+}
+
+vector<uint32_t> QueryEngine::evaluate(const QueryExpr &q) const {
+    Metrics::Timer timer(Phase::Query);
+    IdSet s = eval(idx, q, idx.student_count());
+    make_sparse(s);
+    return move(s.ids);
+}
@@ -0,0 +1,39 @@
+#ifndef QUERYENGINE_H
+#define QUERYENGINE_H
+
+#include "CourseIndex.h"
+#include <vector>
+#include <string>
+
+// A boolean query over course grades, e.g.
+//   CS101>=8 AND 201>=8 AND NOT MATH102
+//   (ML201=8..9.5 OR ML301>9) AND NOT 101<6
+// A predicate is a course code optionally followed by >=, >, <=, < or = and a
+// grade, or =lo..hi for an inclusive range; a bare code matches any grade.
+// AND binds tighter than OR; &, | and ! are accepted as well.
+struct QueryExpr {
+    enum Kind { PRED, AND, OR, NOT };
+    Kind kind = PRED;
+    CourseID course;
+    Grade lo = 0, hi = 0;
+    vector<QueryExpr> children;
+
+    // False (with a message in *error) if text is not a valid query.
+    static bool parse(const string &text, QueryExpr &out, string *error = nullptr);
+};
+
+// Evaluates QueryExprs against a built CourseIndex. Every subresult is a set
+// of student indices kept either as a sorted id list (sparse) or as a bitmap
+// over all students (dense, once it would hold more than 1 in 32 students):
+// sparse AND uses galloping intersection, dense operands combine a word at a
+// time, and NOT under AND becomes a set difference instead of a complement.
+class QueryEngine {
+private:
+    const CourseIndex &idx;
+public:
+    explicit QueryEngine(const CourseIndex &index) : idx(index) {}
+    // Matching student indices, ascending.
+    vector<uint32_t> evaluate(const QueryExpr &q) const;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "RankTable.h"
+#include <algorithm>
+#include <cmath>
+
+optional<double> RankTable::cgpa_of(const Student &s) {
+    double sum = 0;
+    size_t n = 0;
+    for_each_unique_course(s, [&](const CourseEntry &p) { sum += p.second; ++n; });
+    if (n == 0) return nullopt;
+    return sum / n;
+}
+
+int RankTable::bucket_of(double cgpa) {
+    int b = (int)lround(cgpa * 100);
+    return b < 0 ? 0 : b >= BUCKETS ? BUCKETS - 1 : b;
+}
+
+int32_t RankTable::group_for(const string &branch, int year) {
+    auto it = groupIds.find({branch, year});
+    if (it != groupIds.end()) return it->second;
+    Group g;
+    g.branch = branch;
+    g.year = year;
+    g.tree.assign(BUCKETS + 1, 0);
+    g.members.resize(BUCKETS);
+    groups.push_back(move(g));
+    return groupIds[{branch, year}] = (int32_t)groups.size() - 1;
+}
+
+// Fenwick positions run from the highest bucket (1) to the lowest (BUCKETS),
+// so a prefix sum counts students with a higher CGPA.
+void RankTable::tree_add(Group &g, int bucket, int delta) {
+    for (int i = BUCKETS - bucket; i <= BUCKETS; i += i & -i) g.tree[i] += delta;
+}
+
+size_t RankTable::count_above(const Group &g, int bucket) const {
+    size_t n = 0;
+    for (int i = BUCKETS - bucket - 1; i > 0; i -= i & -i) n += g.tree[i];
+    return n;
+}
+
+void RankTable::place(uint32_t student) {
+    Entry &e = entries[student];
+    e = Entry();
+    auto c = cgpa_of((*students)[student]);
+    if (!c) return;
+    e.cgpa = *c;
+    e.group = group_for((*students)[student].get_branch(), (*students)[student].get_startYear());
+    e.bucket = (uint16_t)bucket_of(*c);
+    Group &g = groups[e.group];
+    e.slot = (uint32_t)g.members[e.bucket].size();
+    g.members[e.bucket].push_back(student);
+    g.count++;
+}
+
+void RankTable::build_from(const vector<Student> &students) {
+    this->students = &students;
+    groups.clear();
+    groupIds.clear();
+    entries.assign(students.size(), Entry());
+    for (uint32_t i = 0; i < students.size(); ++i) place(i);
+    // Linear-time Fenwick construction from the bucket sizes.
+    for (auto &g : groups) {
+        for (int i = 1; i <= BUCKETS; ++i) {
+            g.tree[i] += (uint32_t)g.members[BUCKETS - i].size();
+            int j = i + (i & -i);
+            if (j <= BUCKETS) g.tree[j] += g.tree[i];
+        }
+    }
+}
+
+void RankTable::insert(uint32_t student) {
+    if (!students) return;
+    if (entries.size() <= student) entries.resize(student + 1);
+    place(student);
+    const Entry &e = entries[student];
+    if (e.group >= 0) tree_add(groups[e.group], e.bucket, +1);
+}
+
+void RankTable::erase(uint32_t student) {
+    if (student >= entries.size() || entries[student].group < 0) return;
+    Entry &e = entries[student];
+    Group &g = groups[e.group];
+    auto &m = g.members[e.bucket];
+    uint32_t moved = m.back();
+    m[e.slot] = moved;
+    entries[moved].slot = e.slot;
+    m.pop_back();
+    tree_add(g, e.bucket, -1);
+    g.count--;
+    e = Entry();
+}
+
+void RankTable::update(uint32_t student) {
+    erase(student);
+    insert(student);
+}
+
+void RankTable::relocate(uint32_t from, uint32_t to) {
+    if (from >= entries.size()) return;
+    if (entries.size() <= to) entries.resize(to + 1);
+    entries[to] = entries[from];
+    const Entry &e = entries[to];
+    if (e.group >= 0) groups[e.group].members[e.bucket][e.slot] = to;
+    entries[from] = Entry();
+}
+
+optional<double> RankTable::cgpa(uint32_t student) const {
+    if (student >= entries.size() || entries[student].group < 0) return nullopt;
+    return entries[student].cgpa;
+}
+
+optional<size_t> RankTable::rank_of(uint32_t student) const {
+    if (student >= entries.size() || entries[student].group < 0) return nullopt;
+    const Entry &e = entries[student];
+    return count_above(groups[e.group], e.bucket) + 1;
+}
+
+size_t RankTable::group_size(const string &branch, int year) const {
+    auto it = groupIds.find({branch, year});
+    return it == groupIds.end() ? 0 : groups[it->second].count;
+}
+
+vector<uint32_t> RankTable::top_k(const string &branch, int year, size_t k) const {
+    auto it = groupIds.find({branch, year});
+    if (it == groupIds.end() || k == 0) return {};
+    const Group &g = groups[it->second];
+
+    // Binary lifting over the tree: the first position whose prefix reaches k.
+    int pos = 0;
+    size_t seen = 0;
+    for (int step = 1 << 10; step > 0; step >>= 1) {
+        if (pos + step <= BUCKETS && seen + g.tree[pos + step] < k) {
+            pos += step;
+            seen += g.tree[pos];
+        }
+    }
+    int lowest = max(0, BUCKETS - (pos + 1));
+
+    vector<uint32_t> out;
+    for (int b = BUCKETS - 1; b >= lowest; --b)
+        out.insert(out.end(), g.members[b].begin(), g.members[b].end());
+    auto &st = *students;
+    sort(out.begin(), out.end(), [&](uint32_t a, uint32_t b) {
+        if (entries[a].cgpa != entries[b].cgpa) return entries[a].cgpa > entries[b].cgpa;
+        int c = compare_roll(st[a].get_roll(), st[b].get_roll());
+        return c != 0 ? c < 0 : a < b;
+    });
+    if (out.size() > k) out.resize(k);
+    return out;
+}
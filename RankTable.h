@@ -0,0 +1,66 @@
+#ifndef RANKTABLE_H
+#define RANKTABLE_H
+
+#include "Student.h"
+#include <vector>
+#include <map>
+
+// Materialized CGPA and rank table. CGPA is the mean grade over a student's
+// distinct courses (current and previous, first grade per course, as the
+// course index uses). Students are grouped by (branch, startYear); each group
+// keeps a Fenwick tree over CGPA buckets of 0.01 plus the members of every
+// bucket, so rank_of is O(log B) and top_k finds its cut-off bucket in
+// O(log B) (B = 1001 buckets). Students without courses are not ranked.
+// Like CourseIndex, entries refer to students by index; the cached CGPA and
+// group let erase run after the record has already changed.
+class RankTable {
+private:
+    static const int BUCKETS = 1001; // CGPA 0.00 .. 10.00
+    struct Group {
+        string branch;
+        int year;
+        size_t count = 0;
+        vector<uint32_t> tree;              // Fenwick tree, position 1 = highest bucket
+        vector<vector<uint32_t>> members;   // per bucket
+    };
+    struct Entry {
+        double cgpa = 0;
+        int32_t group = -1; // -1 = not ranked
+        uint16_t bucket = 0;
+        uint32_t slot = 0;  // position in its bucket's member list
+    };
+    vector<Group> groups;
+    map<pair<string, int>, int32_t> groupIds;
+    vector<Entry> entries;
+    const vector<Student> *students = nullptr;
+
+    static int bucket_of(double cgpa);
+    int32_t group_for(const string &branch, int year);
+    void tree_add(Group &g, int bucket, int delta);
+    size_t count_above(const Group &g, int bucket) const;
+    void place(uint32_t student);
+public:
+    static optional<double> cgpa_of(const Student &s);
+
+    void build_from(const vector<Student> &students);
+    // Points a copy of the index at a copy of the vector it was built over.
+    void rebind(const vector<Student> &copy) { if (students) students = &copy; }
+    // Adds students[student] (e.g. after a push_back).
+    void insert(uint32_t student);
+    // Removes students[student] from the table.
+    void erase(uint32_t student);
+    // Recomputes students[student] after its courses changed (e.g. add_course).
+    void update(uint32_t student);
+    // Repoints the entry of students[from] at index `to` (swap-and-pop).
+    void relocate(uint32_t from, uint32_t to);
+
+    optional<double> cgpa(uint32_t student) const;
+    // 1-based rank within the student's (branch, startYear) group; students
+    // in the same 0.01 CGPA bucket share a rank.
+    optional<size_t> rank_of(uint32_t student) const;
+    size_t group_size(const string &branch, int year) const;
+    // Best k of a group by CGPA, then roll.
+    vector<uint32_t> top_k(const string &branch, int year, size_t k) const;
+};
+
+#endif
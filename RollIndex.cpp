@@ -0,0 +1,107 @@
+#include "RollIndex.h"
+#include <functional>
+#include <charconv>
+
+uint64_t RollIndex::key_of(const RollID &r, uint32_t &tag) {
+    if (auto p = get_if<uint64_t>(&r)) { tag = 1; return *p; }
+    tag = 2;
+    return hash<string_view>()(get<string>(r));
+}
+
+void RollIndex::place(const Slot &s) {
+    size_t mask = slots.size() - 1;
+    size_t i = home(s.key);
+    while (slots[i].tag) i = (i + 1) & mask;
+    slots[i] = s;
+    ++used;
+}
+
+void RollIndex::reset(size_t cap) {
+    slots.assign(cap, Slot{0, 0, 0});
+    shift = 64;
+    for (size_t c = cap; c > 1; c >>= 1) --shift;
+    used = 0;
+}
+
+void RollIndex::grow() {
+    vector<Slot> old;
+    old.swap(slots);
+    reset(old.empty() ? 16 : old.size() * 2);
+    for (auto &s : old) if (s.tag) place(s);
+}
+
+void RollIndex::build_from(const vector<Student> &students) {
+    this->students = &students;
+    size_t cap = 16;
+    while (cap * 7 < students.size() * 10) cap <<= 1;
+    reset(cap);
+    for (uint32_t i = 0; i < students.size(); ++i) insert(i);
+}
+
+optional<uint32_t> RollIndex::find_by_roll(const RollID &r) const {
+    if (slots.empty()) return nullopt;
+    uint32_t tag;
+    uint64_t key = key_of(r, tag);
+    size_t mask = slots.size() - 1;
+    for (size_t i = home(key); slots[i].tag; i = (i + 1) & mask) {
+        const Slot &s = slots[i];
+        if (s.tag != tag || s.key != key) continue;
+        if (tag == 1 || get<string>((*students)[s.student].get_roll()) == get<string>(r)) return s.student;
+    }
+    return nullopt;
+}
+
+optional<uint32_t> RollIndex::find_by_text(const string &roll) const {
+    bool digits = !roll.empty() && (roll.size() == 1 || roll[0] != '0');
+    for (char c : roll) digits = digits && isdigit((unsigned char)c);
+    // Past 2^64 - 1 the loader keeps the roll as text.
+    uint64_t v;
+    if (digits && from_chars(roll.data(), roll.data() + roll.size(), v).ec == errc()) {
+        if (auto h = find_by_roll(RollID(v))) return h;
+    }
+    return find_by_roll(RollID(roll));
+}
+
+void RollIndex::insert(uint32_t student) {
+    if (!students) return;
+    if ((used + 1) * 10 > slots.size() * 7) grow();
+    uint32_t tag;
+    uint64_t key = key_of((*students)[student].get_roll(), tag);
+    place(Slot{key, student, tag});
+}
+
+size_t RollIndex::locate(uint32_t student) const {
+    if (slots.empty()) return SIZE_MAX;
+    uint32_t tag;
+    uint64_t key = key_of((*students)[student].get_roll(), tag);
+    size_t mask = slots.size() - 1;
+    for (size_t i = home(key); slots[i].tag; i = (i + 1) & mask)
+        if (slots[i].student == student && slots[i].key == key && slots[i].tag == tag) return i;
+    return SIZE_MAX;
+}
+
+void RollIndex::erase(uint32_t student) {
+    size_t i = locate(student);
+    if (i == SIZE_MAX) return;
+    // Backward-shift deletion: pull later entries of the probe run into the hole,
+    // so no tombstones are needed and probe lengths stay short.
+    size_t mask = slots.size() - 1;
+    size_t j = i;
+    while (true) {
+        slots[i].tag = 0;
+        while (true) {
+            j = (j + 1) & mask;
+            if (!slots[j].tag) { --used; return; }
+            size_t k = home(slots[j].key);
+            // Entry j may move to i only if its home is not cyclically in (i, j].
+            if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) break;
+        }
+        slots[i] = slots[j];
+        i = j;
+    }
+}
+
+void RollIndex::relocate(uint32_t from, uint32_t to) {
+    size_t i = locate(from);
+    if (i != SIZE_MAX) slots[i].student = to;
+}
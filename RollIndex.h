@@ -0,0 +1,45 @@
+#ifndef ROLLINDEX_H
+#define ROLLINDEX_H
+
+#include "Student.h"
+#include <vector>
+
+// Open-addressing hash index from roll number to student index.
+// Integer rolls are keyed by value; string rolls by their hash, with the
+// stored record checked on lookup so colliding strings never match.
+// Duplicate rolls may coexist (e.g. old CSVs); erase/move target one index.
+class RollIndex {
+private:
+    struct Slot {
+        uint64_t key;
+        uint32_t student;
+        uint32_t tag; // 0 = empty, 1 = integer roll, 2 = string roll
+    };
+    vector<Slot> slots;
+    size_t used = 0;
+    const vector<Student> *students = nullptr;
+
+    static uint64_t key_of(const RollID &r, uint32_t &tag);
+    unsigned shift = 64;
+    size_t home(uint64_t key) const { return (key * 0x9e3779b97f4a7c15ULL) >> shift; }
+    size_t locate(uint32_t student) const;
+    void place(const Slot &s);
+    void reset(size_t cap);
+    void grow();
+public:
+    void build_from(const vector<Student> &students);
+    // Points a copy of the index at a copy of the vector it was built over.
+    void rebind(const vector<Student> &copy) { if (students) students = &copy; }
+    optional<uint32_t> find_by_roll(const RollID &r) const;
+    // Parses typed input the way the CSV loader would (digits -> integer roll).
+    optional<uint32_t> find_by_text(const string &roll) const;
+    // Indexes students[student] (e.g. after a push_back).
+    void insert(uint32_t student);
+    // Drops students[student]; call before the record changes or moves.
+    void erase(uint32_t student);
+    // Repoints the entry of students[from] at index `to` (swap-and-pop).
+    void relocate(uint32_t from, uint32_t to);
+    size_t size() const { return used; }
+};
+
+#endif
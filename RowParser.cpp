@@ -0,0 +1,189 @@
+#include "RowParser.h"
+#include "ERPUtils.h"
+#include <charconv>
+#include <sstream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+size_t RowCounts::rejected() const {
+    size_t n = 0;
+    for (int i = 0; i < (int)RowStatus::COUNT; ++i) if (RowParser::rejects((RowStatus)i)) n += by_status[i];
+    return n;
+}
+
+size_t RowCounts::repaired() const {
+    size_t n = 0;
+    for (int i = 1; i < (int)RowStatus::COUNT; ++i) if (!RowParser::rejects((RowStatus)i)) n += by_status[i];
+    return n;
+}
+
+void RowCounts::add(const RowCounts &o) {
+    for (int i = 0; i < (int)RowStatus::COUNT; ++i) by_status[i] += o.by_status[i];
+}
+
+string RowCounts::summary() const {
+    stringstream ss;
+    for (int pass = 0; pass < 2; ++pass) {
+        bool rejecting = pass == 0;
+        size_t total = rejecting ? rejected() : repaired();
+        if (!total) continue;
+        if (ss.tellp() > 0) ss << ", ";
+        ss << total << (rejecting ? " rejected (" : " repaired (");
+        bool firstReason = true;
+        for (int i = 1; i < (int)RowStatus::COUNT; ++i) {
+            if (!by_status[i] || RowParser::rejects((RowStatus)i) != rejecting) continue;
+            ss << (firstReason ? "" : ", ") << RowParser::name((RowStatus)i) << " " << by_status[i];
+            firstReason = false;
+        }
+        ss << ")";
+    }
+    return ss.str();
+}
+
+const char* RowParser::name(RowStatus s) {
+    switch (s) {
+        case RowStatus::Ok: return "ok";
+        case RowStatus::TooFewFields: return "too few fields";
+        case RowStatus::BadRoll: return "bad roll";
+        case RowStatus::BadYear: return "bad year";
+        case RowStatus::BadGrade: return "bad grade";
+        case RowStatus::BadCourse: return "bad course";
+        default: return "?";
+    }
+}
+
+static bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+static string_view trim_view(const char *a, const char *b) {
+    while (a < b && is_space(*a)) ++a;
+    while (b > a && is_space(b[-1])) --b;
+    return string_view(a, b - a);
+}
+
+// Bit i is set when p[i] is one of , ; : or newline, for the n <= 16 bytes at p.
+static uint32_t delim_mask(const char *p, size_t n) {
+#ifdef __SSE2__
+    if (n == 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')), _mm_cmpeq_epi8(v, _mm_set1_epi8(';'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        return (uint32_t)_mm_movemask_epi8(hits);
+    }
+#endif
+    uint32_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char c = p[i];
+        if (c == ',' || c == ';' || c == ':' || c == '\n') m |= 1u << i;
+    }
+    return m;
+}
+
+// A leading number in the manner of stoi/stod: an optional '+' is allowed
+// and trailing text is ignored. False when there is no number or it is out
+// of range; clean is false when text follows it.
+template <class T>
+static bool parse_number(string_view s, T &v, bool &clean) {
+    const char *a = s.data(), *b = a + s.size();
+    if (b - a > 1 && *a == '+' && a[1] != '+' && a[1] != '-') ++a;
+    T x{};
+    auto r = from_chars(a, b, x);
+    clean = r.ec == errc() && r.ptr == b;
+    if (r.ec != errc()) return false;
+    v = x;
+    return true;
+}
+
+// All-digit rolls are numbers (false if one overflows); anything else is kept as text.
+static bool parse_roll(string_view f, RollID &roll) {
+    bool digits = !f.empty();
+    for (char c : f) if (c < '0' || c > '9') { digits = false; break; }
+    if (!digits) { roll = string(f); return true; }
+    uint64_t v = 0;
+    auto r = from_chars(f.data(), f.data() + f.size(), v);
+    if (r.ec != errc()) return false;
+    roll = v;
+    return true;
+}
+
+RowParser::RowParser(const char *begin, const char *e) : first(begin), pos(begin), end(e), block(begin) {
+    mask = delim_mask(block, (size_t)min<ptrdiff_t>(16, end - block));
+}
+
+// Next delimiter in the range, or end.
+const char *RowParser::next_delim() {
+    while (!mask) {
+        if (end - block <= 16) return end;
+        block += 16;
+        mask = delim_mask(block, (size_t)min<ptrdiff_t>(16, end - block));
+    }
+    const char *d = block + __builtin_ctz(mask);
+    mask &= mask - 1;
+    return d;
+}
+
+// One "code:grade" token of a course list, ending at stop.
+void RowParser::add_token(const char *tok, const char *colon, const char *stop, bool current, RowStatus &issue) {
+    auto note = [&](RowStatus s) { if (issue == RowStatus::Ok) issue = s; };
+    if (trim_view(tok, stop).empty()) return;
+    if (!colon) { note(RowStatus::BadCourse); return; }
+    string_view code = trim_view(tok, colon);
+    if (code.empty()) note(RowStatus::BadCourse);
+    Grade g = 0;
+    bool clean = false;
+    if (!parse_number(trim_view(colon + 1, stop), g, clean)) g = 0;
+    if (!clean) note(RowStatus::BadGrade);
+    auto it = cache.find(code);
+    if (it == cache.end())
+        it = cache.emplace(code, CourseDict::intern(ERPUtils::parse_course_id(string(code)))).first;
+    (current ? cur : prev).emplace_back(it->second, g);
+}
+
+bool RowParser::next(Student &out, RowStatus &status, size_t &offset) {
+    while (pos < end) {
+        const char *row = pos, *d;
+        string_view head[4];
+        int field = 0;
+        const char *fieldStart = row, *tok = row, *colon = nullptr;
+        RowStatus issue = RowStatus::Ok;
+        cur.clear();
+        prev.clear();
+        // Fields 4 and 5 are course lists; ';' and ':' mean nothing elsewhere.
+        while (true) {
+            d = next_delim();
+            char c = d < end ? *d : '\n';
+            bool courses = field == 4 || field == 5;
+            if (c == ':') { if (courses && !colon) colon = d; continue; }
+            if (c == ';') {
+                if (courses) { add_token(tok, colon, d, field == 4, issue); tok = d + 1; colon = nullptr; }
+                continue;
+            }
+            if (field < 4) head[field] = trim_view(fieldStart, d);
+            else if (courses) add_token(tok, colon, d, field == 4, issue);
+            if (c == '\n') break;
+            ++field;
+            fieldStart = tok = d + 1;
+            colon = nullptr;
+        }
+        pos = d < end ? d + 1 : end;
+        if (d == row) continue;
+
+        offset = row - first;
+        // A trailing comma does not start another field, as with getline.
+        int fields = fieldStart < d ? field + 1 : field;
+        if (fields < 4) { status = RowStatus::TooFewFields; return true; }
+        RollID roll;
+        if (!parse_roll(head[0], roll)) { status = RowStatus::BadRoll; return true; }
+        int year = 2020;
+        bool clean = false;
+        if (!parse_number(head[3], year, clean)) year = 2020;
+        status = clean ? issue : RowStatus::BadYear;
+        out = Student(move(roll), string(head[1]), string(head[2]), year);
+        out.set_course_keys(cur, prev);
+        return true;
+    }
+    return false;
+}
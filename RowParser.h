@@ -0,0 +1,54 @@
+#ifndef ROWPARSER_H
+#define ROWPARSER_H
+
+#include "Student.h"
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Outcome of parsing one CSV row. TooFewFields and BadRoll (an all-digit
+// roll that overflows) reject the row. The others still load it, with the
+// bad part defaulted as the loader always has: BadYear -> 2020, BadGrade ->
+// the leading number or 0, BadCourse -> a token without ':' is skipped (an
+// empty code is kept).
+enum class RowStatus : uint8_t { Ok, TooFewFields, BadRoll, BadYear, BadGrade, BadCourse, COUNT };
+
+// Rows seen per status.
+struct RowCounts {
+    size_t by_status[(int)RowStatus::COUNT] = {};
+    size_t rejected() const;
+    size_t repaired() const;
+    void add(const RowCounts &o);
+    // e.g. "2 rejected (too few fields 2), 5 repaired (bad year 5)"; empty if every row was clean.
+    string summary() const;
+};
+
+// CSV row parser over a byte range that must outlive it. A delimiter
+// scanner finds ',', ';', ':' and '\n' 16 bytes at a time (SSE2), fields
+// stay string_views into the range and numbers go through from_chars. The
+// only allocations are the Student's own members and one cache entry per
+// distinct course code.
+class RowParser {
+private:
+    const char *first, *pos, *end;
+    const char *block;  // 16-byte window of the scanner
+    uint32_t mask = 0;  // delimiters in the window not yet returned
+    unordered_map<string_view, CourseKey> cache;
+    vector<CourseEntry> cur, prev; // course lists of the current row, reused
+
+    const char *next_delim();
+    void add_token(const char *tok, const char *colon, const char *stop, bool current, RowStatus &issue);
+public:
+    RowParser(const char *begin, const char *end);
+
+    // Parses the next non-empty line into out (left untouched when the row
+    // is rejected); offset is the line's distance from begin. False once
+    // the range is exhausted.
+    bool next(Student &out, RowStatus &status, size_t &offset);
+
+    static bool rejects(RowStatus s) { return s == RowStatus::TooFewFields || s == RowStatus::BadRoll; }
+    static const char* name(RowStatus s);
+};
+
+#endif
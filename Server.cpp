@@ -0,0 +1,324 @@
+#include "Server.h"
+#include "ERPUtils.h"
+#include "QueryEngine.h"
+#include <sstream>
+#include <unordered_map>
+#include <deque>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace {
+const size_t READ_BATCH = 16;      // reads per pool task
+const size_t MAX_LINE = 1u << 20;  // longer requests close the connection
+
+string student_row(const Student &s) {
+    return to_string_variant(s.get_roll()) + "," + s.get_name() + "," + s.get_branch() + "," + to_string(s.get_startYear());
+}
+
+string reply(const vector<string> &rows) {
+    string out = "OK " + to_string(rows.size()) + "\n";
+    for (auto &r : rows) out += r + "\n";
+    return out;
+}
+
+string error(const string &msg) { return "ERR " + msg + "\n"; }
+
+// Splits "VERB rest" into an upper-cased verb and the trimmed rest.
+void split_command(const string &line, string &verb, string &rest) {
+    size_t sp = line.find(' ');
+    verb = line.substr(0, sp);
+    for (auto &c : verb) c = (char)toupper((unsigned char)c);
+    rest = sp == string::npos ? "" : line.substr(sp + 1);
+    size_t a = rest.find_first_not_of(' ');
+    rest = a == string::npos ? "" : rest.substr(a);
+}
+
+bool is_write(const string &line) {
+    string verb, rest;
+    split_command(line, verb, rest);
+    return verb == "ADD" || verb == "DEL";
+}
+}
+
+struct QueryServer::Conn {
+    explicit Conn(int f) : fd(f) {}
+    int fd;
+    string buffer;          // bytes after the last complete line
+    deque<string> pending;  // complete lines not yet dispatched
+    string out;             // reply bytes not yet written
+    size_t sent = 0;
+    bool busy = false;      // a request is in flight or its reply is being written
+    bool eof = false;
+};
+
+QueryServer::QueryServer(Dataset &d, Journal &j, const Options &o)
+    : data(d), journal(j), opt(o), pool(o.threads ? o.threads : max(1u, thread::hardware_concurrency())) {}
+
+QueryServer::~QueryServer() {
+    if (listenFd >= 0) {
+        close(listenFd);
+        if (!opt.port) unlink(opt.socket_path.c_str());
+    }
+    for (int fd : wakePipe) if (fd >= 0) close(fd);
+}
+
+bool QueryServer::start() {
+    if (opt.port) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)opt.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            cerr << "Error: cannot bind 127.0.0.1:" << opt.port << ": " << strerror(errno) << "\n";
+            return false;
+        }
+    } else {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (opt.socket_path.empty() || opt.socket_path.size() >= sizeof(addr.sun_path)) {
+            cerr << "Error: bad socket path '" << opt.socket_path << "'\n";
+            return false;
+        }
+        strcpy(addr.sun_path, opt.socket_path.c_str());
+        // A socket file left by a previous run would make bind fail.
+        struct stat sb;
+        if (stat(opt.socket_path.c_str(), &sb) == 0 && S_ISSOCK(sb.st_mode)) unlink(opt.socket_path.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            cerr << "Error: cannot bind " << opt.socket_path << ": " << strerror(errno) << "\n";
+            return false;
+        }
+    }
+    if (listen(listenFd, 128) != 0 || pipe(wakePipe) != 0) {
+        cerr << "Error: " << strerror(errno) << "\n";
+        return false;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    fcntl(wakePipe[0], F_SETFL, fcntl(wakePipe[0], F_GETFL) | O_NONBLOCK);
+    // A full pipe already wakes the I/O thread, so finish() never needs to wait on it.
+    fcntl(wakePipe[1], F_SETFL, fcntl(wakePipe[1], F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+void QueryServer::stop() {
+    stopping = true;
+    if (wakePipe[1] >= 0) {
+        char c = 's';
+        ssize_t r = write(wakePipe[1], &c, 1);
+        (void)r;
+    }
+}
+
+// Called on a worker: queues the reply for the I/O thread, which owns the socket.
+// The wake-up is written under the lock: once run() has taken the last reply
+// it may return and the pipe be closed, so no write may follow the push.
+void QueryServer::finish(int conn, const string &text) {
+    lock_guard<mutex> lock(doneMtx);
+    done.push_back({conn, text});
+    char c = 'd';
+    ssize_t r = write(wakePipe[1], &c, 1);
+    (void)r;
+}
+
+void QueryServer::dispatch(vector<Request> &reads, vector<Request> &writes) {
+    if (!reads.empty()) {
+        auto snap = data.snapshot();
+        for (size_t b = 0; b < reads.size(); b += READ_BATCH) {
+            vector<Request> batch(reads.begin() + b, reads.begin() + min(reads.size(), b + READ_BATCH));
+            pool.submit([this, snap, batch = move(batch)]() {
+                for (auto &r : batch) finish(r.conn, answer(*snap, r.line));
+            });
+        }
+    }
+    if (!writes.empty()) {
+        pool.submit([this, batch = move(writes)]() {
+            vector<string> replies(batch.size());
+            data.modify([&](DatasetVersion &next) {
+                for (size_t i = 0; i < batch.size(); ++i) replies[i] = apply_write(next, batch[i].line);
+            });
+            for (size_t i = 0; i < batch.size(); ++i) finish(batch[i].conn, replies[i]);
+        });
+    }
+    reads.clear();
+    writes.clear();
+}
+
+void QueryServer::run() {
+    unordered_map<int, unique_ptr<Conn>> conns;
+    vector<pollfd> fds;
+    vector<Request> reads, writes;
+    size_t inflight = 0;
+    char buf[65536];
+
+    // Writes as much of the reply as the socket takes; the connection takes
+    // its next request once all of it is out. A failed send drops the reply.
+    auto flush = [](Conn &c) {
+        while (c.sent < c.out.size()) {
+            ssize_t w = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (w <= 0) { c.eof = true; break; }
+            c.sent += (size_t)w;
+        }
+        c.out.clear();
+        c.sent = 0;
+        c.busy = false;
+    };
+
+    // Once stopping, replies still being written are dropped after the
+    // requests in flight finish, so a client that never reads cannot hold
+    // shutdown up.
+    while (!stopping || inflight > 0) {
+        fds.clear();
+        fds.push_back({wakePipe[0], POLLIN, 0});
+        if (!stopping) fds.push_back({listenFd, POLLIN, 0});
+        for (auto &kv : conns) {
+            Conn &c = *kv.second;
+            if (!c.out.empty()) fds.push_back({kv.first, POLLOUT, 0});
+            else if (!stopping && !c.busy && !c.eof) fds.push_back({kv.first, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) break;
+
+        while (read(wakePipe[0], buf, sizeof(buf)) > 0) {}
+        {
+            lock_guard<mutex> lock(doneMtx);
+            for (auto &d : done) {
+                Conn &c = *conns[d.first];
+                c.out = move(d.second);
+                --inflight;
+                flush(c);
+            }
+            done.clear();
+        }
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            if (fds[i].fd == listenFd) {
+                for (int fd; (fd = accept(listenFd, nullptr, nullptr)) >= 0;) {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    conns[fd] = unique_ptr<Conn>(new Conn(fd));
+                }
+                continue;
+            }
+            Conn &c = *conns[fds[i].fd];
+            if (fds[i].events == POLLOUT) {
+                if (!c.out.empty()) flush(c);
+                continue;
+            }
+            ssize_t n = read(c.fd, buf, sizeof(buf));
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+            if (n <= 0) { c.eof = true; continue; }
+            c.buffer.append(buf, (size_t)n);
+            size_t start = 0;
+            for (size_t nl; (nl = c.buffer.find('\n', start)) != string::npos; start = nl + 1) {
+                size_t end = nl > start && c.buffer[nl - 1] == '\r' ? nl - 1 : nl;
+                if (end > start) c.pending.push_back(c.buffer.substr(start, end - start));
+            }
+            c.buffer.erase(0, start);
+            if (c.buffer.size() > MAX_LINE) c.eof = true;
+        }
+
+        // One request per idle connection; everything collected here shares a snapshot.
+        for (auto it = conns.begin(); it != conns.end();) {
+            Conn &c = *it->second;
+            if (!c.busy && !c.pending.empty() && !stopping) {
+                Request r{c.fd, move(c.pending.front())};
+                c.pending.pop_front();
+                (is_write(r.line) ? writes : reads).push_back(move(r));
+                c.busy = true;
+                ++inflight;
+            }
+            if (!c.busy && c.eof && (c.pending.empty() || stopping)) {
+                close(c.fd);
+                it = conns.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        dispatch(reads, writes);
+    }
+    for (auto &kv : conns) close(kv.first);
+}
+
+string QueryServer::answer(const DatasetVersion &v, const string &line) const {
+    string verb, rest;
+    split_command(line, verb, rest);
+    vector<string> rows;
+    auto &st = v.students;
+
+    if (verb == "PING") return reply(rows);
+    if (verb == "STATS") return reply({to_string(v.version) + "," + to_string(st.size())});
+    if (verb == "TOP") {
+        stringstream ss(rest);
+        string course;
+        double min_grade;
+        size_t limit = opt.max_rows;
+        if (!(ss >> course >> min_grade)) return error("usage: TOP <course> <min> [limit]");
+        if (ss >> limit) limit = min(limit, opt.max_rows);
+        auto res = v.cidx.top_students_for_course(ERPUtils::parse_course_id(course), min_grade);
+        ostringstream row;
+        for (size_t i = 0; i < res.size() && i < limit; ++i) {
+            row.str("");
+            row << to_string_variant(st[res[i].student].get_roll()) << "," << st[res[i].student].get_name() << "," << res[i].grade;
+            rows.push_back(row.str());
+        }
+        return reply(rows);
+    }
+    if (verb == "QUERY") {
+        QueryExpr q;
+        string err;
+        if (!QueryExpr::parse(rest, q, &err)) return error(err);
+        auto res = QueryEngine(v.cidx).evaluate(q);
+        for (size_t i = 0; i < res.size() && i < opt.max_rows; ++i) rows.push_back(student_row(st[res[i]]));
+        return reply(rows);
+    }
+    if (verb == "NAME") {
+        for (uint32_t i : v.names.search(rest, opt.max_rows)) rows.push_back(student_row(st[i]));
+        return reply(rows);
+    }
+    if (verb == "FIND" || verb == "RANK") {
+        auto found = v.ridx.find_by_text(rest);
+        if (!found) return error("no student with roll " + rest);
+        const Student &s = st[*found];
+        if (verb == "FIND") return reply({student_row(s)});
+        auto rank = v.ranks.rank_of(*found);
+        if (!rank) return error("student has no courses");
+        ostringstream row;
+        row << to_string_variant(s.get_roll()) << "," << *v.ranks.cgpa(*found) << "," << *rank << ","
+            << v.ranks.group_size(s.get_branch(), s.get_startYear());
+        return reply({row.str()});
+    }
+    if (verb == "ADD" || verb == "DEL") return error(verb + " is a write");
+    return error("unknown command " + verb);
+}
+
+// Runs inside Dataset::modify, so writes are journaled in version order.
+string QueryServer::apply_write(DatasetVersion &next, const string &line) {
+    string verb, rest;
+    split_command(line, verb, rest);
+    if (verb == "ADD") {
+        Student s;
+        RowStatus st;
+        if (!ERPUtils::parse_student(rest, s, &st)) return error(string("bad record (") + RowParser::name(st) + ")");
+        if (next.ridx.find_by_roll(s.get_roll())) return error("roll already used");
+        journal.log_add(s);
+        next.add(s);
+        return reply({student_row(s)});
+    }
+    auto found = next.ridx.find_by_text(rest);
+    if (!found) return error("no student with roll " + rest);
+    RollID roll = next.students[*found].get_roll();
+    size_t n = next.remove(roll);
+    journal.log_delete(roll);
+    return reply({to_string(n)});
+}
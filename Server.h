@@ -0,0 +1,77 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "Dataset.h"
+#include "Journal.h"
+#include "ThreadPool.h"
+#include <string>
+#include <atomic>
+
+// Long-running query server over a Unix domain socket or a localhost TCP
+// port. The protocol is one request per line; every reply starts with
+// "OK <n>" followed by n result lines, or is a single "ERR <message>" line.
+//   PING
+//   STATS                      version, records
+//   TOP <course> <min> [limit] roll,name,grade in index order
+//   QUERY <expr>               roll,name,branch,year (QueryEngine syntax)
+//   NAME <text>                roll,name,branch,year (prefix, then fuzzy)
+//   FIND <roll>                roll,name,branch,year
+//   RANK <roll>                roll,cgpa,rank,group size
+//   ADD <csv record>           adds a student (its roll must be new)
+//   DEL <roll>                 deletes every record with that roll
+// Results are capped at max_rows lines.
+//
+// One I/O thread polls the sockets and hands complete lines to a fixed
+// ThreadPool. Each connection has at most one request in flight, so its
+// replies come back in order. Workers hand replies back to the I/O thread,
+// which writes them as the non-blocking sockets accept them, so a client
+// that stops reading stalls only itself. All reads that arrive together are
+// answered against one snapshot of the Dataset, split into small batches. Writes
+// that arrive together go through one Dataset::modify() call, which
+// publishes one new version.
+class QueryServer {
+public:
+    struct Options {
+        string socket_path;  // Unix socket; used when port is 0
+        int port = 0;        // TCP port on 127.0.0.1
+        unsigned threads = 0; // worker threads (0 = hardware_concurrency)
+        size_t max_rows = 1000;
+    };
+
+    QueryServer(Dataset &data, Journal &journal, const Options &opt);
+    ~QueryServer();
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // Binds and listens; false (with a message on stderr) if the address is unusable.
+    bool start();
+    // Serves until stop() is called; waits for requests in flight.
+    void run();
+    // Safe to call from a signal handler.
+    void stop();
+
+    // Answers one request line against a snapshot (reads only).
+    string answer(const DatasetVersion &v, const string &line) const;
+private:
+    struct Conn;
+    struct Request {
+        int conn;
+        string line;
+    };
+
+    Dataset &data;
+    Journal &journal;
+    Options opt;
+    ThreadPool pool;
+    int listenFd = -1;
+    int wakePipe[2] = {-1, -1};
+    atomic<bool> stopping{false};
+    mutex doneMtx;
+    vector<pair<int, string>> done; // (connection, reply) for the I/O thread to write
+
+    void finish(int conn, const string &reply);
+    void dispatch(vector<Request> &reads, vector<Request> &writes);
+    string apply_write(DatasetVersion &next, const string &line);
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include "Snapshot.h"
+#include "ERPUtils.h"
+#include "Metrics.h"
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using clk = chrono::high_resolution_clock;
+
+// SnapshotView
+SnapshotView::~SnapshotView() { close(); }
+
+void SnapshotView::close() {
+    if (base) munmap(const_cast<char*>(base), size);
+    base = nullptr; size = 0; hdr = nullptr;
+}
+
+bool SnapshotView::open(const string &filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(Snapshot::Header)) { ::close(fd); return false; }
+    void *map = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    base = static_cast<const char*>(map);
+    size = (size_t)sb.st_size;
+    auto h = reinterpret_cast<const Snapshot::Header*>(base);
+    bool ok = memcmp(h->magic, Snapshot::MAGIC, sizeof(h->magic)) == 0
+           && h->version == Snapshot::VERSION && h->file_size == size;
+    for (uint32_t s = 0; ok && s < Snapshot::SECTION_COUNT; ++s) ok = h->section[s] <= size;
+    if (!ok) { close(); return false; }
+    hdr = h;
+    if (!valid()) { close(); return false; }
+    return true;
+}
+
+// Bytes from section s to the next section (or the end of the file).
+size_t SnapshotView::section_bytes(Snapshot::Section s) const {
+    uint64_t end = s + 1 < Snapshot::SECTION_COUNT ? hdr->section[s + 1] : size;
+    return end >= hdr->section[s] ? end - hdr->section[s] : 0;
+}
+
+// An offset table of n+1 entries: starts at 0, never decreases and ends
+// within limit. last is its final entry.
+bool SnapshotView::valid_offsets(Snapshot::Section off, size_t n, uint64_t limit, uint64_t &last) const {
+    if (section_bytes(off) / sizeof(uint64_t) < n + 1) return false;
+    auto o = col<uint64_t>(off);
+    if (o[0] != 0) return false;
+    for (size_t i = 0; i < n; ++i) if (o[i + 1] < o[i]) return false;
+    last = o[n];
+    return last <= limit;
+}
+
+// Every read the accessors can make stays inside its section: columns hold
+// count (or course_count) values, offset tables are monotonic and end inside
+// their payload, and course references are below course_count.
+bool SnapshotView::valid() const {
+    using namespace Snapshot;
+    for (uint32_t s = 0; s < SECTION_COUNT; ++s)
+        if (hdr->section[s] % 8 != 0 || (s > 0 && hdr->section[s] < hdr->section[s - 1])) return false;
+    if (hdr->section[0] < sizeof(Header)) return false;
+    size_t n = hdr->count, c = hdr->course_count;
+    // Each row and course takes at least one byte, which also rules out overflow below.
+    if (n > size || c > size) return false;
+    auto fits = [&](Section s, size_t elems, size_t width) { return section_bytes(s) / width >= elems; };
+    if (!fits(ROLL_KIND, n, 1) || !fits(ROLL_INT, n, 8) || !fits(START_YEAR, n, 4)
+        || !fits(COURSE_KIND, c, 1) || !fits(COURSE_INT, c, 4)) return false;
+    uint64_t last;
+    if (!valid_offsets(ROLL_STR_OFF, n, section_bytes(ROLL_STR), last)
+        || !valid_offsets(NAME_OFF, n, section_bytes(NAME), last)
+        || !valid_offsets(BRANCH_OFF, n, section_bytes(BRANCH), last)
+        || !valid_offsets(COURSE_STR_OFF, c, section_bytes(COURSE_STR), last)) return false;
+    Section lists[2][3] = {{CUR_OFF, CUR_COURSE, CUR_GRADE}, {PREV_OFF, PREV_COURSE, PREV_GRADE}};
+    for (auto &l : lists) {
+        uint64_t entries;
+        if (!valid_offsets(l[0], n, min(section_bytes(l[1]) / 4, section_bytes(l[2]) / 8), entries)) return false;
+        auto courses = col<uint32_t>(l[1]);
+        for (uint64_t k = 0; k < entries; ++k) if (courses[k] >= c) return false;
+    }
+    return true;
+}
+
+CourseID SnapshotView::course(uint32_t c) const {
+    if (col<uint8_t>(Snapshot::COURSE_KIND)[c] == 0) return CourseID(col<int32_t>(Snapshot::COURSE_INT)[c]);
+    return CourseID(string(str_at(Snapshot::COURSE_STR_OFF, Snapshot::COURSE_STR, c)));
+}
+
+RollID SnapshotView::roll(size_t i) const {
+    if (roll_is_int(i)) return RollID(roll_int(i));
+    return RollID(string(roll_str(i)));
+}
+
+Student SnapshotView::to_student(size_t i) const {
+    Student s(roll(i), string(name(i)), string(branch(i)), start_year(i));
+    for (size_t k = cur_begin(i); k < cur_end(i); ++k) s.add_course(course(cur_courses()[k]), cur_grades()[k], true);
+    for (size_t k = prev_begin(i); k < prev_end(i); ++k) s.add_course(course(prev_courses()[k]), prev_grades()[k], false);
+    return s;
+}
+
+// Writer: columns are accumulated in memory, then laid out 8-byte aligned.
+namespace {
+struct Column {
+    string bytes;
+    template <typename T> void put(const T &v) { bytes.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+};
+
+struct StringColumn {
+    Column off, data;
+    StringColumn() { off.put<uint64_t>(0); }
+    void add(const string &s) { data.bytes += s; off.put<uint64_t>(data.bytes.size()); }
+};
+
+// As in the journal's compaction.
+bool fsync_path(const string &path, bool directory = false) {
+    int fd = open(path.c_str(), directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+string dir_of(const string &path) {
+    auto pos = path.find_last_of('/');
+    return pos == string::npos ? "." : path.substr(0, pos + 1);
+}
+}
+
+bool ERPUtils::save_snapshot(const vector<Student> &students, const string &filename) {
+    Metrics::Timer timer(Phase::Save);
+    Column sec[Snapshot::SECTION_COUNT];
+    StringColumn rollStr, names, branches, courseStr;
+    vector<uint32_t> localId(CourseDict::size(), UINT32_MAX);
+    uint64_t nCourses = 0;
+
+    // Only courses that occur get a slot in the file's own course table.
+    auto intern = [&](CourseKey k) {
+        if (k >= localId.size()) localId.resize(k + 1, UINT32_MAX);
+        if (localId[k] != UINT32_MAX) return localId[k];
+        localId[k] = (uint32_t)nCourses++;
+        CourseID c = CourseDict::lookup(k);
+        bool isInt = holds_alternative<int>(c);
+        sec[Snapshot::COURSE_KIND].put<uint8_t>(isInt ? 0 : 1);
+        sec[Snapshot::COURSE_INT].put<int32_t>(isInt ? get<int>(c) : 0);
+        courseStr.add(isInt ? string() : get<string>(c));
+        return localId[k];
+    };
+
+    uint64_t nCur = 0, nPrev = 0;
+    sec[Snapshot::CUR_OFF].put<uint64_t>(0);
+    sec[Snapshot::PREV_OFF].put<uint64_t>(0);
+    for (const auto &s : students) {
+        bool isInt = holds_alternative<uint64_t>(s.get_roll());
+        sec[Snapshot::ROLL_KIND].put<uint8_t>(isInt ? 0 : 1);
+        sec[Snapshot::ROLL_INT].put<uint64_t>(isInt ? get<uint64_t>(s.get_roll()) : 0);
+        rollStr.add(isInt ? string() : get<string>(s.get_roll()));
+        names.add(s.get_name());
+        branches.add(s.get_branch());
+        sec[Snapshot::START_YEAR].put<int32_t>(s.get_startYear());
+        for (auto &p : s.get_courses()) {
+            sec[Snapshot::CUR_COURSE].put<uint32_t>(intern(p.first));
+            sec[Snapshot::CUR_GRADE].put<double>(p.second);
+        }
+        nCur += s.get_courses().size();
+        sec[Snapshot::CUR_OFF].put<uint64_t>(nCur);
+        for (auto &p : s.get_prevCourses()) {
+            sec[Snapshot::PREV_COURSE].put<uint32_t>(intern(p.first));
+            sec[Snapshot::PREV_GRADE].put<double>(p.second);
+        }
+        nPrev += s.get_prevCourses().size();
+        sec[Snapshot::PREV_OFF].put<uint64_t>(nPrev);
+    }
+    sec[Snapshot::ROLL_STR_OFF] = move(rollStr.off);   sec[Snapshot::ROLL_STR] = move(rollStr.data);
+    sec[Snapshot::NAME_OFF] = move(names.off);         sec[Snapshot::NAME] = move(names.data);
+    sec[Snapshot::BRANCH_OFF] = move(branches.off);    sec[Snapshot::BRANCH] = move(branches.data);
+    sec[Snapshot::COURSE_STR_OFF] = move(courseStr.off); sec[Snapshot::COURSE_STR] = move(courseStr.data);
+
+    Snapshot::Header h{};
+    memcpy(h.magic, Snapshot::MAGIC, sizeof(h.magic));
+    h.version = Snapshot::VERSION;
+    h.count = students.size();
+    h.course_count = nCourses;
+    uint64_t pos = (sizeof(h) + 7) & ~uint64_t(7);
+    for (uint32_t s = 0; s < Snapshot::SECTION_COUNT; ++s) {
+        h.section[s] = pos;
+        pos = (pos + sec[s].bytes.size() + 7) & ~uint64_t(7);
+    }
+    h.file_size = pos;
+
+    // Write to a temp file, fsync it and rename so readers never see a
+    // partial snapshot, even after a crash; a failed write leaves no temp file.
+    string tmp = filename + ".tmp";
+    bool ok;
+    {
+        ofstream ofs(tmp, ios::binary | ios::trunc);
+        ok = ofs.is_open();
+        if (ok) {
+            static const char pad[8] = {};
+            ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            ofs.write(pad, h.section[0] - sizeof(h));
+            for (uint32_t s = 0; s < Snapshot::SECTION_COUNT; ++s) {
+                ofs.write(sec[s].bytes.data(), sec[s].bytes.size());
+                uint64_t end = (s + 1 < Snapshot::SECTION_COUNT) ? h.section[s + 1] : h.file_size;
+                ofs.write(pad, end - h.section[s] - sec[s].bytes.size());
+            }
+            ofs.close();
+            ok = !ofs.fail();
+        }
+    }
+    ok = ok && fsync_path(tmp) && rename(tmp.c_str(), filename.c_str()) == 0;
+    if (!ok) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    fsync_path(dir_of(filename), true);
+    return true;
+}
+
+size_t ERPUtils::load_snapshot(const string &filename, vector<Student> &students, size_t max_records, LoadStats *stats) {
+    Metrics::Timer timer(Phase::Load);
+    auto st = clk::now();
+    SnapshotView view;
+    if (!view.open(filename)) return 0;
+    Metrics::add(Counter::BytesRead, view.byte_size());
+    size_t n = view.count();
+    if (max_records) n = min(n, max_records);
+
+    vector<CourseKey> courses;
+    courses.reserve(view.course_count());
+    for (uint32_t c = 0; c < view.course_count(); ++c) courses.push_back(CourseDict::intern(view.course(c)));
+
+    // Materialize disjoint ranges of rows in parallel directly into place.
+    size_t first = students.size();
+    students.resize(first + n);
+    size_t nthreads = max(1u, thread::hardware_concurrency());
+    if (n < 65536) nthreads = 1;
+    vector<thread> workers;
+    for (size_t t = 0; t < nthreads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = n * t / nthreads; i < n * (t + 1) / nthreads; ++i) {
+                Student s(view.roll(i), string(view.name(i)), string(view.branch(i)), view.start_year(i));
+                for (size_t k = view.cur_begin(i); k < view.cur_end(i); ++k)
+                    s.add_course_key(courses[view.cur_courses()[k]], view.cur_grades()[k], true);
+                for (size_t k = view.prev_begin(i); k < view.prev_end(i); ++k)
+                    s.add_course_key(courses[view.prev_courses()[k]], view.prev_grades()[k], false);
+                students[first + i] = move(s);
+            }
+        });
+    }
+    for (auto &w : workers) w.join();
+    Metrics::add(Counter::RowsParsed, n);
+
+    if (stats) {
+        struct stat sb;
+        stats->bytes = stat(filename.c_str(), &sb) == 0 ? (size_t)sb.st_size : 0;
+        stats->rows = n;
+        stats->duration_us = chrono::duration_cast<chrono::microseconds>(clk::now() - st).count();
+    }
+    return n;
+}
+
+string ERPUtils::snapshot_path(const string &csv_file) {
+    const string ext = ".csv";
+    if (csv_file.size() >= ext.size() && csv_file.compare(csv_file.size() - ext.size(), ext.size(), ext) == 0)
+        return csv_file.substr(0, csv_file.size() - ext.size()) + ".snap";
+    return csv_file + ".snap";
+}
+
+bool ERPUtils::snapshot_is_fresh(const string &csv_file) {
+    struct stat csvSt, snapSt;
+    if (stat(snapshot_path(csv_file).c_str(), &snapSt) != 0) return false;
+    if (stat(csv_file.c_str(), &csvSt) != 0) return true;
+    return snapSt.st_mtim.tv_sec > csvSt.st_mtim.tv_sec
+        || (snapSt.st_mtim.tv_sec == csvSt.st_mtim.tv_sec && snapSt.st_mtim.tv_nsec >= csvSt.st_mtim.tv_nsec);
+}
+
+size_t ERPUtils::convert_csv_to_snapshot(const string &csv_file, const string &snap_file) {
+    vector<Student> students;
+    load_csv(csv_file, students);
+    return save_snapshot(students, snap_file) ? students.size() : 0;
+}
+
+size_t ERPUtils::convert_snapshot_to_csv(const string &snap_file, const string &csv_file) {
+    vector<Student> students;
+    load_snapshot(snap_file, students);
+    save_all_students_to_csv(students, csv_file);
+    return students.size();
+}
@@ -0,0 +1,91 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Student.h"
+#include <string_view>
+
+// Binary columnar snapshot of a student table.
+// Layout: a fixed header followed by 8-byte aligned columns. Variable-length
+// columns (rolls, names, branches, course codes, course lists) are stored as an
+// offset table of count+1 entries plus a contiguous payload.
+namespace Snapshot {
+    constexpr char MAGIC[8] = {'E', 'R', 'P', 'S', 'N', 'A', 'P', '\0'};
+    constexpr uint32_t VERSION = 1;
+
+    enum Section : uint32_t {
+        ROLL_KIND, ROLL_INT, ROLL_STR_OFF, ROLL_STR,
+        NAME_OFF, NAME, BRANCH_OFF, BRANCH, START_YEAR,
+        CUR_OFF, CUR_COURSE, CUR_GRADE,
+        PREV_OFF, PREV_COURSE, PREV_GRADE,
+        COURSE_KIND, COURSE_INT, COURSE_STR_OFF, COURSE_STR,
+        SECTION_COUNT
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t count;
+        uint64_t course_count;
+        uint64_t file_size;
+        uint64_t section[SECTION_COUNT];
+    };
+}
+
+// Read-only mmapped view over a snapshot file; accessors read the columns in
+// place. open() checks every column and offset table once and refuses a
+// damaged file, so the accessors need no bounds checks.
+class SnapshotView {
+private:
+    const char *base = nullptr;
+    size_t size = 0;
+    const Snapshot::Header *hdr = nullptr;
+
+    template <typename T> const T* col(Snapshot::Section s) const {
+        return reinterpret_cast<const T*>(base + hdr->section[s]);
+    }
+    string_view str_at(Snapshot::Section off, Snapshot::Section data, size_t i) const {
+        auto o = col<uint64_t>(off);
+        return string_view(col<char>(data) + o[i], o[i + 1] - o[i]);
+    }
+    size_t section_bytes(Snapshot::Section s) const;
+    bool valid_offsets(Snapshot::Section off, size_t n, uint64_t limit, uint64_t &last) const;
+    bool valid() const;
+
+public:
+    SnapshotView() = default;
+    ~SnapshotView();
+    SnapshotView(const SnapshotView&) = delete;
+    SnapshotView& operator=(const SnapshotView&) = delete;
+
+    bool open(const string &filename);
+    void close();
+    bool is_open() const { return hdr != nullptr; }
+
+    size_t count() const { return hdr->count; }
+    size_t course_count() const { return hdr->course_count; }
+    size_t byte_size() const { return size; }
+
+    bool roll_is_int(size_t i) const { return col<uint8_t>(Snapshot::ROLL_KIND)[i] == 0; }
+    uint64_t roll_int(size_t i) const { return col<uint64_t>(Snapshot::ROLL_INT)[i]; }
+    string_view roll_str(size_t i) const { return str_at(Snapshot::ROLL_STR_OFF, Snapshot::ROLL_STR, i); }
+    string_view name(size_t i) const { return str_at(Snapshot::NAME_OFF, Snapshot::NAME, i); }
+    string_view branch(size_t i) const { return str_at(Snapshot::BRANCH_OFF, Snapshot::BRANCH, i); }
+    int start_year(size_t i) const { return col<int32_t>(Snapshot::START_YEAR)[i]; }
+
+    // Course lists: [begin, end) ranges into the course/grade columns.
+    size_t cur_begin(size_t i) const { return col<uint64_t>(Snapshot::CUR_OFF)[i]; }
+    size_t cur_end(size_t i) const { return col<uint64_t>(Snapshot::CUR_OFF)[i + 1]; }
+    const uint32_t* cur_courses() const { return col<uint32_t>(Snapshot::CUR_COURSE); }
+    const double* cur_grades() const { return col<double>(Snapshot::CUR_GRADE); }
+    size_t prev_begin(size_t i) const { return col<uint64_t>(Snapshot::PREV_OFF)[i]; }
+    size_t prev_end(size_t i) const { return col<uint64_t>(Snapshot::PREV_OFF)[i + 1]; }
+    const uint32_t* prev_courses() const { return col<uint32_t>(Snapshot::PREV_COURSE); }
+    const double* prev_grades() const { return col<double>(Snapshot::PREV_GRADE); }
+
+    CourseID course(uint32_t c) const;
+    RollID roll(size_t i) const;
+    Student to_student(size_t i) const;
+};
+
+#endif
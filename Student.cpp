@@ -6,10 +6,19 @@ Student::Student(RollID r, string n, string br, int sy)
     : roll(move(r)), name(move(n)), branch(move(br)), startYear(sy) {}
 
 void Student::add_course(const CourseID &c, Grade g, bool current) {
+    add_course_key(CourseDict::intern(c), g, current);
+}
+
+void Student::add_course_key(CourseKey c, Grade g, bool current) {
     if (current) courses.emplace_back(c, g);
     else prevCourses.emplace_back(c, g);
 }
 
+void Student::set_course_keys(const vector<CourseEntry> &current, const vector<CourseEntry> &previous) {
+    courses.assign(current.begin(), current.end());
+    prevCourses.assign(previous.begin(), previous.end());
+}
+
 // CourseID Utils
 size_t CourseIDHash::operator()(const CourseID &c) const noexcept {
     if (holds_alternative<int>(c))
@@ -23,8 +32,14 @@ bool CourseIDEq::operator()(const CourseID &a, const CourseID &b) const noexcept
 }
 
 optional<Grade> Student::grade_for_course(const CourseID &c) const {
-    for (auto &p : courses) if (CourseIDEq{}(p.first, c)) return p.second;
-    for (auto &p : prevCourses) if (CourseIDEq{}(p.first, c)) return p.second;
+    auto k = CourseDict::find(c);
+    if (!k) return nullopt;
+    return grade_for_key(*k);
+}
+
+optional<Grade> Student::grade_for_key(CourseKey c) const {
+    for (auto &p : courses) if (p.first == c) return p.second;
+    for (auto &p : prevCourses) if (p.first == c) return p.second;
     return nullopt;
 }
 
@@ -39,9 +54,9 @@ string Student::full_display() const {
     stringstream ss;
     ss << brief() << "\n  Current courses:\n";
     for (auto &p : courses)
-        ss << "    " << to_string_variant(p.first) << " : " << fixed << setprecision(1) << p.second << "\n";
+        ss << "    " << CourseDict::name(p.first) << " : " << fixed << setprecision(1) << p.second << "\n";
     ss << "  Previous courses:\n";
     for (auto &p : prevCourses)
-        ss << "    " << to_string_variant(p.first) << " : " << fixed << setprecision(1) << p.second << "\n";
+        ss << "    " << CourseDict::name(p.first) << " : " << fixed << setprecision(1) << p.second << "\n";
     return ss.str();
 }
\ No newline at end of file
@@ -2,36 +2,58 @@
 #define STUDENT_H
 
 #include "Types.h"
+#include "CourseDict.h"
 #include <vector>
 #include <optional>
 
+using CourseEntry = pair<CourseKey, Grade>;
+
 class Student {
 private:
     RollID roll;
     string name;
     string branch;
     int startYear;
-    vector<pair<CourseID, Grade>> courses;
-    vector<pair<CourseID, Grade>> prevCourses;
+    vector<CourseEntry> courses;
+    vector<CourseEntry> prevCourses;
 
 public:
     Student() = default;
     Student(RollID r, string n, string br, int sy);
 
     void add_course(const CourseID &c, Grade g, bool current = true);
+    void add_course_key(CourseKey c, Grade g, bool current = true);
+    // Replaces both course lists at once (the loader's path).
+    void set_course_keys(const vector<CourseEntry> &current, const vector<CourseEntry> &previous);
 
     const RollID& get_roll() const { return roll; }
     const string& get_name() const { return name; }
     const string& get_branch() const { return branch; }
     int get_startYear() const { return startYear; }
-    const vector<pair<CourseID, Grade>>& get_courses() const { return courses; }
-    const vector<pair<CourseID, Grade>>& get_prevCourses() const { return prevCourses; }
+    const vector<CourseEntry>& get_courses() const { return courses; }
+    const vector<CourseEntry>& get_prevCourses() const { return prevCourses; }
 
     optional<Grade> grade_for_course(const CourseID &c) const;
+    optional<Grade> grade_for_key(CourseKey c) const;
     string brief() const;
     string full_display() const;
 };
 
+// Calls f once per distinct course; a course listed twice keeps its first
+// grade, as grade_for_key does.
+template <typename F>
+inline void for_each_unique_course(const Student &s, F f) {
+    auto seen = [&](size_t upto, CourseKey k, const vector<CourseEntry> &list) {
+        for (size_t j = 0; j < upto; ++j) if (list[j].first == k) return true;
+        return false;
+    };
+    auto &cur = s.get_courses(), &prev = s.get_prevCourses();
+    for (size_t i = 0; i < cur.size(); ++i)
+        if (!seen(i, cur[i].first, cur)) f(cur[i]);
+    for (size_t i = 0; i < prev.size(); ++i)
+        if (!seen(cur.size(), prev[i].first, cur) && !seen(i, prev[i].first, prev)) f(prev[i]);
+}
+
 // Hashing Helpers for Maps
 struct CourseIDHash {
     size_t operator()(const CourseID &c) const noexcept;
@@ -0,0 +1,363 @@
+#include "StudentStore.h"
+#include "ERPUtils.h"
+#include "ParallelSort.h"
+#include "Metrics.h"
+#include <sstream>
+#include <cmath>
+#include <thread>
+#include <deque>
+#include <stdexcept>
+
+using namespace std;
+
+static const size_t PIECE_ROWS = 1u << 16; // records a load_csv worker packs per piece
+static const size_t LIMIT = UINT32_MAX;    // offsets and indices are 32-bit
+
+static void check_room(size_t used, size_t more, const char *what) {
+    if (more > LIMIT - used) throw length_error(string("StudentStore: too many ") + what);
+}
+
+// Size of the glibc malloc chunk serving an n-byte request.
+static size_t malloc_chunk(size_t n) {
+    return n ? max<size_t>(32, (n + 8 + 15) & ~size_t(15)) : 0;
+}
+
+static size_t string_heap(const string &s) {
+    static const size_t inline_capacity = string().capacity();
+    return s.capacity() > inline_capacity ? malloc_chunk(s.capacity() + 1) : 0;
+}
+
+// Buckets plus one node (value, next pointer, cached hash) per element.
+template <class Map>
+static size_t map_heap(const Map &m) {
+    return m.bucket_count() * sizeof(void*) + m.size() * malloc_chunk(sizeof(typename Map::value_type) + 2 * sizeof(void*));
+}
+
+// Hundredths when that reads back as exactly g: k / 100.0 is correctly
+// rounded, so "8.7" parsed and 870 / 100.0 are the same double.
+static bool grade_code(Grade g, uint16_t &code) {
+    if (!(g >= 0 && g < 655.35) || signbit(g)) return false;
+    double k = nearbyint(g * 100);
+    if (k >= 0xFFFF || k / 100 != g) return false;
+    code = (uint16_t)k;
+    return true;
+}
+
+CourseEntry PackedCourses::iterator::operator*() const { return store->entry(pos); }
+
+bool StudentView::roll_is_int() const { return !(store->flags[i] & StudentStore::TEXT_ROLL); }
+
+string_view StudentView::roll_text(char (&buf)[24]) const {
+    if (roll_is_int()) return string_view(buf, to_chars(buf, buf + sizeof(buf), store->rolls[i]).ptr - buf);
+    return string_view(store->text.data() + store->textOff[i], store->rolls[i]);
+}
+
+RollID StudentView::get_roll() const {
+    if (roll_is_int()) return store->rolls[i];
+    char buf[24];
+    return string(roll_text(buf));
+}
+
+string_view StudentView::get_name() const { return store->name_of(i); }
+
+const string& StudentView::get_branch() const {
+    uint8_t b = store->branches[i];
+    if (b == StudentStore::OTHER_BRANCH) return store->otherBranches.at(i);
+    return store->branchNames[b];
+}
+
+int StudentView::get_startYear() const { return store->years[i]; }
+
+PackedCourses StudentView::get_courses() const {
+    return PackedCourses(store, store->courseOff[i], store->prevStart[i]);
+}
+
+PackedCourses StudentView::get_prevCourses() const {
+    return PackedCourses(store, store->prevStart[i], store->courseOff[i + 1]);
+}
+
+optional<Grade> StudentView::grade_for_course(const CourseID &c) const {
+    auto k = CourseDict::find(c);
+    if (!k) return nullopt;
+    return grade_for_key(*k);
+}
+
+// Current courses come first in the entry range, as in Student::grade_for_key.
+optional<Grade> StudentView::grade_for_key(CourseKey c) const {
+    for (uint32_t e = store->courseOff[i]; e < store->courseOff[i + 1]; ++e) {
+        CourseEntry p = store->entry(e);
+        if (p.first == c) return p.second;
+    }
+    return nullopt;
+}
+
+string StudentView::brief() const {
+    char buf[24];
+    stringstream ss;
+    ss << "[" << roll_text(buf) << "] " << get_name() << " (" << get_branch() << ", " << get_startYear() << ")";
+    return ss.str();
+}
+
+Student StudentView::to_student() const {
+    Student s(get_roll(), string(get_name()), get_branch(), get_startYear());
+    for (auto p : get_courses()) s.add_course_key(p.first, p.second, true);
+    for (auto p : get_prevCourses()) s.add_course_key(p.first, p.second, false);
+    return s;
+}
+
+string_view StudentStore::name_of(uint32_t i) const {
+    uint32_t b = textOff[i] + ((flags[i] & TEXT_ROLL) ? (uint32_t)rolls[i] : 0);
+    return string_view(text.data() + b, textOff[i + 1] - b);
+}
+
+CourseEntry StudentStore::entry(uint32_t e) const {
+    const Packed &p = courses[e];
+    CourseKey k = p.key == WIDE ? wideKeys.at(e) : p.key;
+    Grade g = p.grade == WIDE ? exactGrades.at(e) : p.grade / 100.0;
+    return CourseEntry(k, g);
+}
+
+void StudentStore::add_head(bool intRoll, uint64_t roll, string_view rollText, string_view name,
+                            const string &branch, int year) {
+    check_room(years.size(), 1, "students");
+    check_room(text.size(), (intRoll ? 0 : rollText.size()) + name.size(), "text bytes");
+    uint32_t i = (uint32_t)years.size();
+    rolls.push_back(intRoll ? roll : rollText.size());
+    flags.push_back(intRoll ? 0 : TEXT_ROLL);
+    if (!intRoll) text.append(rollText);
+    text.append(name);
+    textOff.push_back((uint32_t)text.size());
+    uint8_t b = branch_code(branch);
+    branches.push_back(b);
+    if (b == OTHER_BRANCH) otherBranches.emplace(i, branch);
+    years.push_back(year);
+}
+
+// Dictionary code of branch, adding it while there is room; OTHER_BRANCH once full.
+uint8_t StudentStore::branch_code(const string &branch) {
+    auto it = branchCodes.find(branch);
+    if (it == branchCodes.end() && branchNames.size() < OTHER_BRANCH) {
+        it = branchCodes.emplace(branch, (uint8_t)branchNames.size()).first;
+        branchNames.push_back(branch);
+    }
+    return it != branchCodes.end() ? it->second : OTHER_BRANCH;
+}
+
+void StudentStore::add_course(CourseKey k, Grade g) {
+    uint32_t e = (uint32_t)courses.size();
+    Packed p;
+    p.key = k < WIDE ? (uint16_t)k : WIDE;
+    if (p.key == WIDE) wideKeys.emplace(e, k);
+    if (!grade_code(g, p.grade)) {
+        p.grade = WIDE;
+        exactGrades.emplace(e, g);
+    }
+    courses.push_back(p);
+}
+
+template <class List>
+void StudentStore::add_courses(const List &cur, const List &prev) {
+    check_room(courses.size(), cur.size() + prev.size(), "course entries");
+    for (auto p : cur) add_course(p.first, p.second);
+    prevStart.push_back((uint32_t)courses.size());
+    for (auto p : prev) add_course(p.first, p.second);
+    courseOff.push_back((uint32_t)courses.size());
+}
+
+void StudentStore::push_back(const Student &s) {
+    const RollID &r = s.get_roll();
+    auto num = get_if<uint64_t>(&r);
+    add_head(num != nullptr, num ? *num : 0, num ? string_view() : string_view(get<string>(r)),
+             s.get_name(), s.get_branch(), s.get_startYear());
+    add_courses(s.get_courses(), s.get_prevCourses());
+}
+
+void StudentStore::append(const StudentStore &src, uint32_t first, uint32_t last) {
+    if (first >= last) return;
+    uint32_t t0 = src.textOff[first], c0 = src.courseOff[first];
+    check_room(size(), last - first, "students");
+    check_room(text.size(), src.textOff[last] - t0, "text bytes");
+    check_room(courses.size(), src.courseOff[last] - c0, "course entries");
+    uint32_t base = (uint32_t)size(), textBase = (uint32_t)text.size(), courseBase = (uint32_t)courses.size();
+
+    rolls.insert(rolls.end(), src.rolls.begin() + first, src.rolls.begin() + last);
+    flags.insert(flags.end(), src.flags.begin() + first, src.flags.begin() + last);
+    years.insert(years.end(), src.years.begin() + first, src.years.begin() + last);
+    // Branch codes belong to each store's dictionary; map src's as they come up.
+    int16_t code[256];
+    fill(begin(code), end(code), -1);
+    for (uint32_t i = first; i < last; ++i) {
+        uint8_t b = src.branches[i];
+        const string &name = b == OTHER_BRANCH ? src.otherBranches.at(i) : src.branchNames[b];
+        if (b == OTHER_BRANCH || code[b] < 0) {
+            uint8_t c = branch_code(name);
+            if (b != OTHER_BRANCH) code[b] = c;
+            b = c;
+        } else {
+            b = (uint8_t)code[b];
+        }
+        branches.push_back(b);
+        if (b == OTHER_BRANCH) otherBranches.emplace(base + (i - first), name);
+    }
+
+    for (uint32_t i = first + 1; i <= last; ++i) textOff.push_back(src.textOff[i] - t0 + textBase);
+    text.append(src.text, t0, src.textOff[last] - t0);
+    for (uint32_t i = first; i < last; ++i) {
+        prevStart.push_back(src.prevStart[i] - c0 + courseBase);
+        courseOff.push_back(src.courseOff[i + 1] - c0 + courseBase);
+    }
+    courses.insert(courses.end(), src.courses.begin() + c0, src.courses.begin() + src.courseOff[last]);
+    for (uint32_t e = c0; e < src.courseOff[last]; ++e) {
+        const Packed &p = src.courses[e];
+        if (p.key == WIDE) wideKeys.emplace(e - c0 + courseBase, src.wideKeys.at(e));
+        if (p.grade == WIDE) exactGrades.emplace(e - c0 + courseBase, src.exactGrades.at(e));
+    }
+}
+
+void StudentStore::reserve(size_t students, size_t textBytes, size_t courseEntries) {
+    rolls.reserve(students);
+    flags.reserve(students);
+    textOff.reserve(students + 1);
+    branches.reserve(students);
+    years.reserve(students);
+    courseOff.reserve(students + 1);
+    prevStart.reserve(students);
+    text.reserve(textBytes);
+    courses.reserve(courseEntries);
+}
+
+void StudentStore::clear() {
+    *this = StudentStore();
+}
+
+void StudentStore::build_from(const vector<Student> &students) {
+    clear();
+    size_t textBytes = 0, entries = 0;
+    for (auto &s : students) {
+        if (auto r = get_if<string>(&s.get_roll())) textBytes += r->size();
+        textBytes += s.get_name().size();
+        entries += s.get_courses().size() + s.get_prevCourses().size();
+    }
+    reserve(students.size(), textBytes, entries);
+    for (auto &s : students) push_back(s);
+}
+
+size_t StudentStore::load_csv(const string &filename, unsigned threads, ReadMode mode) {
+    Metrics::Timer timer(Phase::Load);
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    // Each worker packs its rows into pieces of up to PIECE_ROWS records,
+    // tagged with their line offsets. The merge copies runs of consecutive
+    // rows column by column and frees each piece once drained, so the parsed
+    // rows shrink as the store grows instead of living alongside it.
+    struct Piece {
+        StudentStore rows;
+        vector<size_t> offsets;
+    };
+    vector<deque<Piece>> parts(threads);
+    size_t n = ERPUtils::scan_csv(filename, [&](unsigned w, Student &s, size_t offset) {
+        auto &q = parts[w];
+        if (q.empty() || q.back().offsets.size() == PIECE_ROWS) q.emplace_back();
+        q.back().rows.push_back(s);
+        q.back().offsets.push_back(offset);
+    }, threads, mode);
+
+    size_t count = 0, textBytes = 0, entries = 0;
+    for (auto &q : parts)
+        for (auto &p : q) { count += p.rows.size(); textBytes += p.rows.text.size(); entries += p.rows.courses.size(); }
+    if (count > LIMIT - size() || textBytes > LIMIT - text.size() || entries > LIMIT - courses.size()) return 0;
+    reserve(size() + count, text.size() + textBytes, courses.size() + entries);
+
+    // Take rows from the worker with the lowest head offset up to the next
+    // lowest head of any other worker: one scan over workers per run, not per row.
+    vector<uint32_t> pos(threads, 0);
+    while (true) {
+        int best = -1;
+        size_t head = 0, next = SIZE_MAX;
+        for (unsigned k = 0; k < threads; ++k) {
+            if (parts[k].empty()) continue;
+            size_t h = parts[k].front().offsets[pos[k]];
+            if (best < 0 || h < head) {
+                if (best >= 0) next = head;
+                best = (int)k;
+                head = h;
+            } else {
+                next = min(next, h);
+            }
+        }
+        if (best < 0) break;
+        Piece &p = parts[best].front();
+        uint32_t last = (uint32_t)(lower_bound(p.offsets.begin() + pos[best], p.offsets.end(), next) - p.offsets.begin());
+        append(p.rows, pos[best], last);
+        pos[best] = last;
+        if (last == p.offsets.size()) {
+            parts[best].pop_front();
+            pos[best] = 0;
+        }
+    }
+    return n;
+}
+
+// Sorted on prefix keys, as parallel_sort_indices does in SortMode::Keys;
+// the full text is read only on a tie between long strings.
+vector<uint32_t> StudentStore::sorted(ThreadPool &pool) const {
+    struct Key {
+        uint64_t name[2];
+        uint64_t roll[2];
+        uint32_t index;
+        uint8_t nameLong, rollLong;
+    };
+    vector<Key> keys(size());
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        char buf[24];
+        string_view name = name_of(i), roll = (*this)[i].roll_text(buf);
+        Key &k = keys[i];
+        ParallelSort::pack_prefix(name, k.name);
+        ParallelSort::pack_prefix(roll, k.roll);
+        k.index = i;
+        k.nameLong = name.size() > 16;
+        k.rollLong = roll.size() > 16;
+    }
+    ParallelSort::sort(keys, [&](const Key &a, const Key &b) {
+        if (a.name[0] != b.name[0]) return a.name[0] < b.name[0];
+        if (a.name[1] != b.name[1]) return a.name[1] < b.name[1];
+        if (a.nameLong | b.nameLong) {
+            int c = name_of(a.index).compare(name_of(b.index));
+            if (c != 0) return c < 0;
+        }
+        if (a.roll[0] != b.roll[0]) return a.roll[0] < b.roll[0];
+        if (a.roll[1] != b.roll[1]) return a.roll[1] < b.roll[1];
+        if (a.rollLong | b.rollLong) {
+            char ba[24], bb[24];
+            int c = (*this)[a.index].roll_text(ba).compare((*this)[b.index].roll_text(bb));
+            if (c != 0) return c < 0;
+        }
+        return a.index < b.index;
+    }, pool);
+    vector<uint32_t> idx(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) idx[i] = keys[i].index;
+    return idx;
+}
+
+StudentStore::Usage StudentStore::memory_usage() const {
+    Usage u;
+    u.columns = rolls.capacity() * sizeof(uint64_t) + flags.capacity() + textOff.capacity() * sizeof(uint32_t)
+              + branches.capacity() + years.capacity() * sizeof(int32_t)
+              + (courseOff.capacity() + prevStart.capacity()) * sizeof(uint32_t);
+    u.text = text.capacity();
+    u.courses = courses.capacity() * sizeof(Packed) + map_heap(wideKeys) + map_heap(exactGrades);
+    u.dictionary = map_heap(branchCodes) + map_heap(otherBranches) + branchNames.capacity() * sizeof(string);
+    for (auto &b : branchNames) u.dictionary += 2 * string_heap(b);
+    for (auto &kv : otherBranches) u.dictionary += string_heap(kv.second);
+    return u;
+}
+
+size_t StudentStore::heap_bytes(const vector<Student> &students) {
+    size_t n = students.capacity() * sizeof(Student);
+    for (auto &s : students) {
+        if (auto r = get_if<string>(&s.get_roll())) n += string_heap(*r);
+        n += string_heap(s.get_name()) + string_heap(s.get_branch());
+        n += malloc_chunk(s.get_courses().capacity() * sizeof(CourseEntry));
+        n += malloc_chunk(s.get_prevCourses().capacity() * sizeof(CourseEntry));
+    }
+    return n;
+}
@@ -0,0 +1,152 @@
+#ifndef STUDENTSTORE_H
+#define STUDENTSTORE_H
+
+#include "Student.h"
+#include "ERPUtils.h" // ReadMode
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <optional>
+#include <iterator>
+
+class StudentStore;
+
+// Course list of a stored student; entries are decoded to CourseEntry on access.
+class PackedCourses {
+private:
+    const StudentStore *store;
+    uint32_t first, last;
+public:
+    class iterator {
+    private:
+        const StudentStore *store;
+        uint32_t pos;
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type = CourseEntry;
+        using difference_type = ptrdiff_t;
+        using pointer = void;
+        using reference = CourseEntry;
+
+        iterator(const StudentStore *s, uint32_t p) : store(s), pos(p) {}
+        CourseEntry operator*() const;
+        iterator& operator++() { ++pos; return *this; }
+        bool operator==(const iterator &o) const { return pos == o.pos; }
+        bool operator!=(const iterator &o) const { return pos != o.pos; }
+    };
+
+    PackedCourses(const StudentStore *s, uint32_t b, uint32_t e) : store(s), first(b), last(e) {}
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    CourseEntry operator[](size_t j) const { return *iterator(store, first + (uint32_t)j); }
+    iterator begin() const { return iterator(store, first); }
+    iterator end() const { return iterator(store, last); }
+};
+
+// One stored student behind Student's accessors. Strings are views into the
+// store, so a view is valid until the store is next changed.
+class StudentView {
+private:
+    const StudentStore *store;
+    uint32_t i;
+public:
+    StudentView(const StudentStore *s, uint32_t index) : store(s), i(index) {}
+    uint32_t index() const { return i; }
+
+    bool roll_is_int() const;
+    // Printed roll; integer rolls are formatted into buf.
+    string_view roll_text(char (&buf)[24]) const;
+    RollID get_roll() const;
+    string_view get_name() const;
+    const string& get_branch() const;
+    int get_startYear() const;
+    PackedCourses get_courses() const;
+    PackedCourses get_prevCourses() const;
+
+    optional<Grade> grade_for_course(const CourseID &c) const;
+    optional<Grade> grade_for_key(CourseKey c) const;
+    string brief() const;
+    string full_display() const { return to_student().full_display(); }
+    Student to_student() const;
+};
+
+// Students stored column by column. Roll text and names share one
+// append-only text arena addressed by 32-bit offsets, every course entry
+// lives in one flat array of 4-byte entries (16-bit course key, grade in
+// hundredths) and branches are one-byte codes into a dictionary. Values
+// that do not fit (keys >= 65535, grades that are not exact hundredths,
+// more than 255 branches) go to side tables, so every record reads back
+// exactly as added. Append-only; at most 4 GB of text and 2^32 students and
+// entries, past which adding throws length_error.
+class StudentStore {
+public:
+    // Heap bytes by part (capacities, not sizes).
+    struct Usage {
+        size_t columns = 0, text = 0, courses = 0, dictionary = 0;
+        size_t total() const { return columns + text + courses + dictionary; }
+    };
+private:
+    friend class StudentView;
+    friend class PackedCourses;
+
+    struct Packed {
+        uint16_t key;
+        uint16_t grade; // hundredths
+    };
+    static constexpr uint16_t WIDE = 0xFFFF;      // value is in wideKeys / exactGrades
+    static constexpr uint8_t OTHER_BRANCH = 0xFF; // branch is in otherBranches
+    static constexpr uint8_t TEXT_ROLL = 1;
+
+    vector<uint64_t> rolls;          // integer roll, or the length of the roll text
+    vector<uint8_t> flags;
+    vector<uint32_t> textOff{0};     // count+1 offsets: roll text (if any), then name
+    vector<uint8_t> branches;
+    vector<int32_t> years;
+    vector<uint32_t> courseOff{0};   // count+1 offsets: current courses, then previous
+    vector<uint32_t> prevStart;
+    string text;
+    vector<Packed> courses;
+    vector<string> branchNames;
+    unordered_map<string, uint8_t> branchCodes;
+    unordered_map<uint32_t, string> otherBranches; // by student
+    unordered_map<uint32_t, CourseKey> wideKeys;   // by course entry
+    unordered_map<uint32_t, Grade> exactGrades;    // by course entry
+
+    void add_head(bool intRoll, uint64_t roll, string_view rollText, string_view name, const string &branch, int year);
+    uint8_t branch_code(const string &branch);
+    template <class List> void add_courses(const List &cur, const List &prev);
+    void add_course(CourseKey k, Grade g);
+    CourseEntry entry(uint32_t e) const;
+    string_view name_of(uint32_t i) const;
+public:
+    void push_back(const Student &s);
+    // Copies record i of another store.
+    void append(const StudentStore &src, uint32_t i) { append(src, i, i + 1); }
+    // Copies records [first, last) of another store, column by column.
+    void append(const StudentStore &src, uint32_t first, uint32_t last);
+    void build_from(const vector<Student> &students);
+    // Parses the CSV on `threads` threads (0 = hardware_concurrency) straight
+    // into the columns, in file order, reading it as ERPUtils::load_csv does.
+    // Returns the number of records loaded, or 0 (leaving the store as it
+    // was) if they would not fit.
+    size_t load_csv(const string &filename, unsigned threads = 0, ReadMode mode = ReadMode::Auto);
+    void reserve(size_t students, size_t textBytes = 0, size_t courseEntries = 0);
+    void clear();
+
+    size_t size() const { return years.size(); }
+    bool empty() const { return years.empty(); }
+    StudentView operator[](size_t i) const { return StudentView(this, (uint32_t)i); }
+
+    // Indices by name, then roll, then position (parallel_sort_indices order).
+    vector<uint32_t> sorted(ThreadPool &pool) const;
+
+    Usage memory_usage() const;
+    // Heap bytes of the same students held as vector<Student>: the array plus
+    // each string and course list that does not fit inline, at glibc malloc
+    // chunk sizes.
+    static size_t heap_bytes(const vector<Student> &students);
+};
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef STUDENTT_H
+#define STUDENTT_H
+
+#include "Student.h"
+#include "CourseIndex.h" // Posting
+#include "ParallelSort.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <optional>
+#include <sstream>
+
+// A text course code such as CS101, interned in CourseDict. It is a
+// distinct type, so a store of text codes and a store of integer codes
+// cannot be mixed up.
+struct CourseName {
+    CourseKey key;
+    bool operator==(const CourseName &o) const { return key == o.key; }
+};
+namespace std {
+template <> struct hash<CourseName> {
+    size_t operator()(const CourseName &c) const noexcept { return hash<uint32_t>()(c.key); }
+};
+}
+
+// Per-type roll and course operations the stores are compiled against.
+// Roll comparisons follow the printed text, as compare_roll does, so typed
+// and variant stores sort alike.
+template <class T> struct RollTraits;
+template <> struct RollTraits<uint64_t> {
+    static int digits(uint64_t v) {
+        int d = 1;
+        while (v >= 10) { v /= 10; ++d; }
+        return d;
+    }
+    // Text order without formatting: scale both to the same number of digits.
+    static int compare(uint64_t a, uint64_t b) {
+        int da = digits(a), db = digits(b);
+        if (da == db) return a < b ? -1 : a > b;
+        unsigned __int128 x = a, y = b;
+        for (int i = da; i < db; ++i) x *= 10;
+        for (int i = db; i < da; ++i) y *= 10;
+        if (x != y) return x < y ? -1 : 1;
+        return da < db ? -1 : 1; // one is a prefix of the other
+    }
+    static string text(uint64_t r) { return to_string(r); }
+    static RollID to_id(uint64_t r) { return r; }
+    static const uint64_t* from_id(const RollID &r) { return get_if<uint64_t>(&r); }
+};
+template <> struct RollTraits<string> {
+    static int compare(const string &a, const string &b) { return a.compare(b); }
+    static const string& text(const string &r) { return r; }
+    static RollID to_id(const string &r) { return r; }
+    static const string* from_id(const RollID &r) { return get_if<string>(&r); }
+};
+
+template <class T> struct CourseTraits;
+template <> struct CourseTraits<int> {
+    static string text(int c) { return to_string(c); }
+    static optional<int> from_id(const CourseID &c) {
+        if (auto p = get_if<int>(&c)) return *p;
+        return nullopt;
+    }
+};
+template <> struct CourseTraits<CourseName> {
+    static const string& text(CourseName c) { return CourseDict::name(c.key); }
+    static optional<CourseName> from_id(const CourseID &c) {
+        if (!holds_alternative<string>(c)) return nullopt;
+        auto k = CourseDict::find(c);
+        if (!k) return nullopt;
+        return CourseName{*k};
+    }
+};
+
+// Student record with its roll and course code types fixed at compile time,
+// for data from one university. Student (variant-based) holds the rest.
+template <class RollT, class CourseT>
+class StudentT {
+public:
+    using Roll = RollT;
+    using Course = CourseT;
+    using Entry = pair<CourseT, Grade>;
+private:
+    RollT roll;
+    string name;
+    string branch;
+    int startYear = 0;
+    vector<Entry> courses;
+    vector<Entry> prevCourses;
+public:
+    StudentT() = default;
+    StudentT(RollT r, string n, string br, int sy)
+        : roll(move(r)), name(move(n)), branch(move(br)), startYear(sy) {}
+
+    void add_course(CourseT c, Grade g, bool current = true) {
+        (current ? courses : prevCourses).emplace_back(c, g);
+    }
+
+    const RollT& get_roll() const { return roll; }
+    const string& get_name() const { return name; }
+    const string& get_branch() const { return branch; }
+    int get_startYear() const { return startYear; }
+    const vector<Entry>& get_courses() const { return courses; }
+    const vector<Entry>& get_prevCourses() const { return prevCourses; }
+
+    optional<Grade> grade_for(const CourseT &c) const {
+        for (auto &p : courses) if (p.first == c) return p.second;
+        for (auto &p : prevCourses) if (p.first == c) return p.second;
+        return nullopt;
+    }
+    // Same text as Student::brief.
+    string brief() const {
+        stringstream ss;
+        ss << "[" << RollTraits<RollT>::text(roll) << "] " << name << " (" << branch << ", " << startYear << ")";
+        return ss.str();
+    }
+    // Calls f once per distinct course, first grade wins (as for_each_unique_course).
+    template <class F>
+    void for_each_unique_course(F f) const {
+        auto seen = [&](size_t upto, const CourseT &k, const vector<Entry> &list) {
+            for (size_t j = 0; j < upto; ++j) if (list[j].first == k) return true;
+            return false;
+        };
+        for (size_t i = 0; i < courses.size(); ++i)
+            if (!seen(i, courses[i].first, courses)) f(courses[i]);
+        for (size_t i = 0; i < prevCourses.size(); ++i)
+            if (!seen(courses.size(), prevCourses[i].first, courses) && !seen(i, prevCourses[i].first, prevCourses))
+                f(prevCourses[i]);
+    }
+};
+
+using IIITStudent = StudentT<uint64_t, CourseName>; // integer rolls, text course codes
+using IITStudent = StudentT<string, int>;           // text rolls, integer course codes
+
+// Homogeneous store of one StudentT type, with the sort, course index and
+// roll lookup instantiated for it. The index is built on first use and
+// dropped by add().
+template <class S>
+class UniversityStore {
+public:
+    using Roll = typename S::Roll;
+    using Course = typename S::Course;
+private:
+    vector<S> students;
+    unordered_map<Course, vector<Posting>> courseIdx; // grade desc, then roll
+    unordered_map<Roll, uint32_t> rolls;
+    bool indexed = false;
+
+    bool roll_before(uint32_t a, uint32_t b) const {
+        int c = RollTraits<Roll>::compare(students[a].get_roll(), students[b].get_roll());
+        return c != 0 ? c < 0 : a < b;
+    }
+public:
+    void add(S s) {
+        students.push_back(move(s));
+        indexed = false;
+    }
+    // Drops every student with roll r (the rest keep their order); returns how many.
+    size_t remove(const Roll &r) {
+        size_t n = students.size();
+        students.erase(remove_if(students.begin(), students.end(), [&](const S &s) { return s.get_roll() == r; }),
+                       students.end());
+        n -= students.size();
+        if (n) indexed = false;
+        return n;
+    }
+    void reserve(size_t n) { students.reserve(n); }
+    size_t size() const { return students.size(); }
+    const S& operator[](size_t i) const { return students[i]; }
+    const vector<S>& all() const { return students; }
+
+    // Indices by name, then roll, then position (parallel_sort_indices order).
+    vector<uint32_t> sorted(ThreadPool &pool) const {
+        vector<uint32_t> idx(students.size());
+        for (uint32_t i = 0; i < idx.size(); ++i) idx[i] = i;
+        ParallelSort::sort(idx, [&](uint32_t a, uint32_t b) {
+            int c = students[a].get_name().compare(students[b].get_name());
+            return c != 0 ? c < 0 : roll_before(a, b);
+        }, pool);
+        return idx;
+    }
+
+    void build_index() {
+        courseIdx.clear();
+        rolls.clear();
+        for (uint32_t i = 0; i < students.size(); ++i) {
+            rolls.emplace(students[i].get_roll(), i);
+            students[i].for_each_unique_course([&](const typename S::Entry &p) {
+                courseIdx[p.first].push_back({p.second, i});
+            });
+        }
+        // Rank students by roll once so the per-course sorts break ties on integers.
+        vector<uint32_t> byRoll(students.size()), rollRank(students.size());
+        for (uint32_t i = 0; i < byRoll.size(); ++i) byRoll[i] = i;
+        sort(byRoll.begin(), byRoll.end(), [&](uint32_t a, uint32_t b) { return roll_before(a, b); });
+        for (uint32_t r = 0; r < byRoll.size(); ++r) rollRank[byRoll[r]] = r;
+        for (auto &kv : courseIdx)
+            sort(kv.second.begin(), kv.second.end(), [&](const Posting &a, const Posting &b) {
+                if (a.grade != b.grade) return a.grade > b.grade;
+                return rollRank[a.student] < rollRank[b.student];
+            });
+        indexed = true;
+    }
+    void ensure_index() { if (!indexed) build_index(); }
+
+    // Postings with grade >= threshold, best first; needs build_index().
+    vector<Posting> top_for_course(const Course &c, Grade threshold) const {
+        auto it = courseIdx.find(c);
+        if (it == courseIdx.end()) return {};
+        auto &v = it->second;
+        auto end = partition_point(v.begin(), v.end(), [&](const Posting &p) { return p.grade >= threshold; });
+        return vector<Posting>(v.begin(), end);
+    }
+    // First student with this roll; needs build_index().
+    optional<uint32_t> find(const Roll &r) const {
+        auto it = rolls.find(r);
+        if (it == rolls.end()) return nullopt;
+        return it->second;
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+namespace {
+// Which pool (and which slot in it) the current thread works for.
+thread_local const ThreadPool *tlPool = nullptr;
+thread_local unsigned tlSlot = 0;
+}
+
+ThreadPool::ThreadPool(unsigned n) {
+    for (unsigned i = 0; i <= n; ++i) queues.push_back(make_unique<Queue>());
+    for (unsigned i = 0; i < n; ++i) workers.emplace_back([this, i]() { worker_loop(i + 1); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lk(sleepMtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &w : workers) w.join();
+}
+
+unsigned ThreadPool::current_slot() const { return tlPool == this ? tlSlot : 0; }
+
+void ThreadPool::submit(function<void()> task) {
+    // Workers keep their own spawns local; outside threads spread theirs round-robin.
+    size_t q = (tlPool == this) ? tlSlot : nextQueue++ % queues.size();
+    queued++;
+    {
+        lock_guard<mutex> lk(queues[q]->m);
+        queues[q]->tasks.push_back(move(task));
+    }
+    if (!workers.empty()) {
+        lock_guard<mutex> lk(sleepMtx);
+        wake.notify_one();
+    }
+}
+
+bool ThreadPool::pop_local(size_t q, function<void()> &task) {
+    lock_guard<mutex> lk(queues[q]->m);
+    if (queues[q]->tasks.empty()) return false;
+    task = move(queues[q]->tasks.back());
+    queues[q]->tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t self, function<void()> &task) {
+    for (size_t k = 1; k < queues.size(); ++k) {
+        auto &victim = *queues[(self + k) % queues.size()];
+        lock_guard<mutex> lk(victim.m);
+        if (victim.tasks.empty()) continue;
+        task = move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::run_one() {
+    size_t self = (tlPool == this) ? tlSlot : 0;
+    function<void()> task;
+    if (!pop_local(self, task) && !steal(self, task)) return false;
+    queued--;
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(size_t id) {
+    tlPool = this;
+    tlSlot = (unsigned)id;
+    while (true) {
+        if (run_one()) continue;
+        unique_lock<mutex> lk(sleepMtx);
+        wake.wait(lk, [&]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+void TaskGroup::run(function<void()> task) {
+    pending++;
+    pool.submit([this, task = move(task)]() {
+        task();
+        pending--;
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending > 0) {
+        if (!pool.run_one()) this_thread::yield();
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (LIFO, cache-warm), while idle workers steal
+// from the front of other deques (FIFO, oldest and usually largest task).
+// Threads that wait on a TaskGroup run queued tasks instead of blocking,
+// so recursive fork/join never deadlocks, even with zero workers.
+class ThreadPool {
+private:
+    struct Queue {
+        mutex m;
+        deque<function<void()>> tasks;
+    };
+    vector<unique_ptr<Queue>> queues; // one per worker, plus one for outside threads
+    vector<thread> workers;
+    mutex sleepMtx;
+    condition_variable wake;
+    atomic<size_t> queued{0};
+    atomic<size_t> nextQueue{0};
+    bool stopping = false;
+
+    bool pop_local(size_t q, function<void()> &task);
+    bool steal(size_t self, function<void()> &task);
+    void worker_loop(size_t id);
+public:
+    // workers = number of background threads; callers that wait add one more.
+    explicit ThreadPool(unsigned workers);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total threads that execute tasks when the caller helps (workers + 1).
+    unsigned concurrency() const { return (unsigned)workers.size() + 1; }
+    void submit(function<void()> task);
+    // Runs one queued task on the calling thread; false if none was found.
+    bool run_one();
+    // 0 for threads outside the pool, 1..N for pool workers.
+    unsigned current_slot() const;
+};
+
+// Fork/join helper: run() spawns tasks, wait() helps until all have finished.
+class TaskGroup {
+private:
+    ThreadPool &pool;
+    atomic<size_t> pending{0};
+public:
+    explicit TaskGroup(ThreadPool &p) : pool(p) {}
+    ~TaskGroup() { wait(); }
+    void run(function<void()> task);
+    void wait();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "TopK.h"
+#include "ERPUtils.h"
+#include "Metrics.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <thread>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+// What the CourseIndex order looks at: grade (desc), roll, then position.
+struct Key {
+    Grade grade;
+    const RollID *roll;
+    size_t pos;
+};
+
+bool better(const Key &a, const Key &b) {
+    if (a.grade != b.grade) return a.grade > b.grade;
+    int c = compare_roll(*a.roll, *b.roll);
+    return c != 0 ? c < 0 : a.pos < b.pos;
+}
+
+// The best k items seen so far, as a heap whose front is the worst of them.
+template <class T, class KeyOf>
+struct Bounded {
+    size_t k;
+    KeyOf key;
+    vector<T> items;
+
+    bool worse(const T &a, const T &b) const { return better(key(a), key(b)); }
+    // Cheap pre-check so rejected candidates are never built.
+    bool admits(const Key &probe) const { return items.size() < k || (k && better(probe, key(items.front()))); }
+    void push(T item) {
+        auto cmp = [this](const T &a, const T &b) { return worse(a, b); };
+        if (items.size() < k) {
+            items.push_back(move(item));
+            push_heap(items.begin(), items.end(), cmp);
+        } else {
+            pop_heap(items.begin(), items.end(), cmp);
+            items.back() = move(item);
+            push_heap(items.begin(), items.end(), cmp);
+        }
+    }
+};
+
+// Merges the per-thread heaps of one course and returns its list best first.
+template <class T, class KeyOf>
+vector<T> merge(vector<Bounded<T, KeyOf>> &parts, size_t k, KeyOf key) {
+    Bounded<T, KeyOf> all{k, key, {}};
+    for (auto &p : parts)
+        for (auto &item : p.items)
+            if (all.admits(key(item))) all.push(move(item));
+    sort(all.items.begin(), all.items.end(), [&](const T &a, const T &b) { return all.worse(a, b); });
+    return move(all.items);
+}
+
+// Requested course -> slot; repeated courses share one slot.
+struct Slots {
+    vector<int> ofKey;      // by CourseKey, -1 = not requested
+    vector<int> ofRequest;  // by request, -1 = unknown course
+    size_t count = 0;
+
+    int find(CourseKey key) const { return key < ofKey.size() ? ofKey[key] : -1; }
+};
+
+Slots make_slots(const vector<optional<CourseKey>> &keys) {
+    Slots s;
+    s.ofKey.assign(CourseDict::size(), -1);
+    for (auto &k : keys) {
+        if (!k) { s.ofRequest.push_back(-1); continue; }
+        if (s.ofKey[*k] < 0) s.ofKey[*k] = (int)s.count++;
+        s.ofRequest.push_back(s.ofKey[*k]);
+    }
+    return s;
+}
+}
+
+vector<vector<Posting>> TopK::top_k(const vector<Student> &students, const vector<CourseID> &courses, size_t k,
+                                    unsigned threads) {
+    Metrics::Timer timer(Phase::Query);
+    vector<optional<CourseKey>> keys;
+    for (auto &c : courses) keys.push_back(CourseDict::find(c));
+    Slots slots = make_slots(keys);
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    size_t chunks = students.size() < 65536 ? 1 : threads;
+
+    auto key = [&students](const Posting &p) { return Key{p.grade, &students[p.student].get_roll(), p.student}; };
+    using Heap = Bounded<Posting, decltype(key)>;
+    vector<vector<Heap>> heaps(slots.count, vector<Heap>(chunks, Heap{k, key, {}}));
+    {
+        ThreadPool pool(threads - 1);
+        TaskGroup g(pool);
+        for (size_t c = 0; c < chunks && slots.count && k; ++c) {
+            g.run([&, c]() {
+                for (size_t i = students.size() * c / chunks; i < students.size() * (c + 1) / chunks; ++i) {
+                    for_each_unique_course(students[i], [&](const CourseEntry &p) {
+                        int slot = slots.find(p.first);
+                        if (slot < 0) return;
+                        Heap &h = heaps[slot][c];
+                        Posting post{p.second, (uint32_t)i};
+                        if (h.admits(key(post))) h.push(post);
+                    });
+                }
+            });
+        }
+    }
+
+    vector<vector<Posting>> merged(slots.count);
+    for (size_t s = 0; s < slots.count; ++s) merged[s] = merge(heaps[s], k, key);
+    vector<vector<Posting>> out;
+    for (int s : slots.ofRequest) out.push_back(s < 0 ? vector<Posting>() : merged[s]);
+    return out;
+}
+
+vector<vector<TopHit>> TopK::top_k_csv(const string &filename, const vector<CourseID> &courses, size_t k,
+                                       unsigned threads, const unordered_set<string> &dropped,
+                                       const vector<Student> &added) {
+    Metrics::Timer timer(Phase::Query);
+    // Interned up front so the parser maps the requested codes to known keys.
+    vector<optional<CourseKey>> keys;
+    for (auto &c : courses) keys.push_back(CourseDict::intern(c));
+    Slots slots = make_slots(keys);
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    auto key = [](const TopHit &h) { return Key{h.grade, &h.student.get_roll(), h.offset}; };
+    using Heap = Bounded<TopHit, decltype(key)>;
+    vector<vector<Heap>> heaps(slots.count, vector<Heap>(threads, Heap{k, key, {}}));
+    auto visit = [&](unsigned part, const Student &s, size_t offset) {
+        for_each_unique_course(s, [&](const CourseEntry &p) {
+            int slot = slots.find(p.first);
+            if (slot < 0) return;
+            Heap &h = heaps[slot][part];
+            if (h.admits(Key{p.second, &s.get_roll(), offset})) h.push(TopHit{p.second, offset, s});
+        });
+    };
+    if (slots.count && k) {
+        ERPUtils::scan_csv(filename, [&](unsigned part, Student &s, size_t offset) {
+            if (dropped.empty() || !dropped.count(to_string_variant(s.get_roll()))) visit(part, s, offset);
+        }, threads);
+        struct stat sb;
+        size_t end = stat(filename.c_str(), &sb) == 0 ? (size_t)sb.st_size : 0;
+        for (size_t i = 0; i < added.size(); ++i) visit(0, added[i], end + i);
+    }
+
+    vector<vector<TopHit>> merged(slots.count);
+    for (size_t s = 0; s < slots.count; ++s) merged[s] = merge(heaps[s], k, key);
+    vector<vector<TopHit>> out;
+    for (int s : slots.ofRequest) out.push_back(s < 0 ? vector<TopHit>() : merged[s]);
+    return out;
+}
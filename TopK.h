@@ -0,0 +1,35 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "CourseIndex.h"
+#include <vector>
+#include <string>
+#include <unordered_set>
+
+// Streaming top-K per course. Each requested course keeps a bounded heap of
+// its best K entries, so one "top 50 in CS101" question costs O(n log K) time
+// and O(K) memory per course instead of building and sorting every posting
+// list. Work is split across threads, each with its own heaps, and the
+// per-thread heaps are merged at the end.
+// Results are ordered like CourseIndex lists: grade (desc), then roll, then
+// position; a student counts once per course, with the grade the index uses.
+struct TopHit {
+    Grade grade;
+    size_t offset;   // byte offset of the record's line in the file (added records count on from its end)
+    Student student;
+};
+
+namespace TopK {
+    // One list per requested course over loaded students (unknown courses give an empty list).
+    vector<vector<Posting>> top_k(const vector<Student> &students, const vector<CourseID> &courses, size_t k,
+                                  unsigned threads = 0);
+    // Same, straight from the parse stream of a CSV file without loading it;
+    // only the records that make a list are kept. Records whose roll is in
+    // dropped are skipped and added ones follow the file, which is how
+    // Journal::changes describes a replay.
+    vector<vector<TopHit>> top_k_csv(const string &filename, const vector<CourseID> &courses, size_t k,
+                                     unsigned threads = 0, const unordered_set<string> &dropped = {},
+                                     const vector<Student> &added = {});
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include <string>
 #include <iostream>
 #include <cstdint> // <--- THIS WAS MISSING
+#include <string_view>
+#include <charconv>
 
 using namespace std;
 
@@ -12,6 +14,7 @@ using namespace std;
 using RollID = variant<uint64_t, string>;
 using CourseID = variant<int, string>;
 using Grade = double;
+using CourseKey = uint32_t; // dense id assigned by CourseDict
 
 // Helpers
 inline string to_string_variant(const RollID &r) {
@@ -23,4 +26,15 @@ inline string to_string_variant(const CourseID &c) {
     return get<string>(c);
 }
 
+// Printed form of a roll without allocating; integer rolls are formatted into buf.
+inline string_view roll_view(const RollID &r, char (&buf)[24]) {
+    if (auto p = get_if<uint64_t>(&r)) return string_view(buf, to_chars(buf, buf + sizeof(buf), *p).ptr - buf);
+    return get<string>(r);
+}
+// Same order as comparing to_string_variant(a) with to_string_variant(b).
+inline int compare_roll(const RollID &a, const RollID &b) {
+    char ba[24], bb[24];
+    return roll_view(a, ba).compare(roll_view(b, bb));
+}
+
 #endif
\ No newline at end of file
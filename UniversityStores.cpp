@@ -0,0 +1,247 @@
+#include "UniversityStores.h"
+#include "ERPUtils.h"
+#include "Metrics.h"
+#include <thread>
+
+using namespace std;
+
+template <class S>
+class TypedSource : public StudentSource {
+private:
+    const char *tag;
+    UniversityStore<S> &store;
+    using Roll = typename S::Roll;
+public:
+    TypedSource(const char *t, UniversityStore<S> &s) : tag(t), store(s) {}
+    const char* label() const override { return tag; }
+    size_t size() const override { return store.size(); }
+    const string& name(uint32_t i) const override { return store[i].get_name(); }
+    string_view roll(uint32_t i, char (&buf)[24]) const override {
+        if constexpr (is_same<Roll, uint64_t>::value)
+            return string_view(buf, to_chars(buf, buf + sizeof(buf), store[i].get_roll()).ptr - buf);
+        else
+            return store[i].get_roll();
+    }
+    string brief(uint32_t i) const override { return store[i].brief(); }
+    vector<uint32_t> sorted(ThreadPool &pool) const override { return store.sorted(pool); }
+    vector<Posting> top_for_course(const CourseID &c, Grade threshold) override {
+        auto course = CourseTraits<typename S::Course>::from_id(c);
+        if (!course) return {};
+        store.ensure_index();
+        return store.top_for_course(*course, threshold);
+    }
+    optional<uint32_t> find(const RollID &r) override {
+        auto roll = RollTraits<Roll>::from_id(r);
+        if (!roll) return nullopt;
+        store.ensure_index();
+        return store.find(*roll);
+    }
+};
+
+class MixedSource : public StudentSource {
+private:
+    UniversityStores &owner;
+public:
+    explicit MixedSource(UniversityStores &o) : owner(o) {}
+    const char* label() const override { return "mixed"; }
+    size_t size() const override { return owner.mixed.size(); }
+    const string& name(uint32_t i) const override { return owner.mixed[i].get_name(); }
+    string_view roll(uint32_t i, char (&buf)[24]) const override { return roll_view(owner.mixed[i].get_roll(), buf); }
+    string brief(uint32_t i) const override { return owner.mixed[i].brief(); }
+    vector<uint32_t> sorted(ThreadPool &pool) const override {
+        auto &st = owner.mixed;
+        vector<uint32_t> idx(st.size());
+        for (uint32_t i = 0; i < idx.size(); ++i) idx[i] = i;
+        ParallelSort::sort(idx, [&](uint32_t a, uint32_t b) {
+            int c = st[a].get_name().compare(st[b].get_name());
+            if (c == 0) c = compare_roll(st[a].get_roll(), st[b].get_roll());
+            return c != 0 ? c < 0 : a < b;
+        }, pool);
+        return idx;
+    }
+    vector<Posting> top_for_course(const CourseID &c, Grade threshold) override {
+        owner.ensure_mixed_index();
+        return owner.mixedCourses.top_students_for_course(c, threshold);
+    }
+    optional<uint32_t> find(const RollID &r) override {
+        owner.ensure_mixed_index();
+        return owner.mixedRolls.find_by_roll(r);
+    }
+};
+
+void UniversityStores::ensure_mixed_index() {
+    if (mixedIndexed) return;
+    mixedCourses.build_from(mixed);
+    mixedRolls.build_from(mixed);
+    mixedIndexed = true;
+}
+
+// Decides the store of each record and converts it. Remembers the kind of
+// every course key it has seen, so CourseDict is asked once per code.
+class UniversityStores::Router {
+private:
+    vector<int8_t> kinds; // per CourseKey: 0 = unseen, 1 = integer code, 2 = text code
+    vector<int> values;   // the integer code
+    int8_t kind(CourseKey k) {
+        if (k >= kinds.size()) { kinds.resize(k + 1, 0); values.resize(k + 1, 0); }
+        if (!kinds[k]) {
+            CourseID id = CourseDict::lookup(k);
+            if (auto p = get_if<int>(&id)) { kinds[k] = 1; values[k] = *p; }
+            else kinds[k] = 2;
+        }
+        return kinds[k];
+    }
+public:
+    UniversityStores::Store route(const Student &s) {
+        bool text = true, ints = true;
+        for (auto *list : {&s.get_courses(), &s.get_prevCourses()})
+            for (auto &p : *list) {
+                if (kind(p.first) == 1) text = false;
+                else ints = false;
+            }
+        bool intRoll = holds_alternative<uint64_t>(s.get_roll());
+        if (intRoll && text) return UniversityStores::IIIT;
+        if (!intRoll && ints) return UniversityStores::IIT;
+        return UniversityStores::Mixed;
+    }
+    IIITStudent to_iiit(const Student &s) {
+        IIITStudent t(get<uint64_t>(s.get_roll()), s.get_name(), s.get_branch(), s.get_startYear());
+        for (auto &p : s.get_courses()) t.add_course(CourseName{p.first}, p.second, true);
+        for (auto &p : s.get_prevCourses()) t.add_course(CourseName{p.first}, p.second, false);
+        return t;
+    }
+    IITStudent to_iit(const Student &s) {
+        IITStudent t(get<string>(s.get_roll()), s.get_name(), s.get_branch(), s.get_startYear());
+        for (auto &p : s.get_courses()) t.add_course(values[p.first], p.second, true);
+        for (auto &p : s.get_prevCourses()) t.add_course(values[p.first], p.second, false);
+        return t;
+    }
+};
+
+namespace {
+// One worker's records for one store, tagged with their line offsets.
+template <class T>
+using Tagged = vector<pair<size_t, T>>;
+
+// Merges the workers' runs (each in offset order) into file order.
+template <class T, class Put>
+void merge_runs(vector<Tagged<T>> &runs, Put put) {
+    vector<size_t> pos(runs.size(), 0);
+    while (true) {
+        int best = -1;
+        for (size_t k = 0; k < runs.size(); ++k)
+            if (pos[k] < runs[k].size() && (best < 0 || runs[k][pos[k]].first < runs[best][pos[best]].first))
+                best = (int)k;
+        if (best < 0) break;
+        put(move(runs[best][pos[best]++].second));
+    }
+}
+}
+
+UniversityStores::UniversityStores() : router(new Router()) {
+    sources.emplace_back(new TypedSource<IIITStudent>("IIIT-Delhi", iiit));
+    sources.emplace_back(new TypedSource<IITStudent>("IIT-Delhi", iit));
+    sources.emplace_back(new MixedSource(*this));
+}
+
+UniversityStores::~UniversityStores() = default;
+
+void UniversityStores::add(const Student &s) {
+    Router &r = *router;
+    switch (r.route(s)) {
+        case IIIT: iiit.add(r.to_iiit(s)); break;
+        case IIT: iit.add(r.to_iit(s)); break;
+        default: mixed.push_back(s); mixedIndexed = false; break;
+    }
+}
+
+size_t UniversityStores::remove(const RollID &r) {
+    size_t n = mixed.size();
+    mixed.erase(remove_if(mixed.begin(), mixed.end(), [&](const Student &s) { return s.get_roll() == r; }), mixed.end());
+    n -= mixed.size();
+    if (n) mixedIndexed = false;
+    if (auto roll = RollTraits<uint64_t>::from_id(r)) n += iiit.remove(*roll);
+    if (auto roll = RollTraits<string>::from_id(r)) n += iit.remove(*roll);
+    return n;
+}
+
+size_t UniversityStores::load_csv(const string &filename, unsigned threads, const unordered_set<string> &dropped,
+                                  const vector<Student> &added) {
+    Metrics::Timer timer(Phase::Load);
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    vector<Router> routers(threads);
+    vector<Tagged<IIITStudent>> a(threads);
+    vector<Tagged<IITStudent>> b(threads);
+    vector<Tagged<Student>> c(threads);
+    ERPUtils::scan_csv(filename, [&](unsigned w, Student &s, size_t offset) {
+        if (!dropped.empty() && dropped.count(to_string_variant(s.get_roll()))) return;
+        switch (routers[w].route(s)) {
+            case IIIT: a[w].emplace_back(offset, routers[w].to_iiit(s)); break;
+            case IIT: b[w].emplace_back(offset, routers[w].to_iit(s)); break;
+            default: c[w].emplace_back(offset, move(s)); break;
+        }
+    }, threads);
+
+    size_t na = 0, nb = 0, nc = 0;
+    for (unsigned w = 0; w < threads; ++w) { na += a[w].size(); nb += b[w].size(); nc += c[w].size(); }
+    iiit.reserve(iiit.size() + na);
+    iit.reserve(iit.size() + nb);
+    mixed.reserve(mixed.size() + nc);
+    merge_runs(a, [&](IIITStudent &&s) { iiit.add(move(s)); });
+    merge_runs(b, [&](IITStudent &&s) { iit.add(move(s)); });
+    merge_runs(c, [&](Student &&s) { mixed.push_back(move(s)); });
+    mixedIndexed = false;
+    for (auto &s : added) add(s);
+    return na + nb + nc + added.size();
+}
+
+// Name (when byName), then printed roll, then store and index.
+int UniversityStores::compare(const Ref &a, const Ref &b, bool byName) {
+    StudentSource &sa = *sources[a.store], &sb = *sources[b.store];
+    if (byName) {
+        int c = sa.name(a.index).compare(sb.name(b.index));
+        if (c != 0) return c;
+    }
+    char ba[24], bb[24];
+    int c = sa.roll(a.index, ba).compare(sb.roll(b.index, bb));
+    if (c != 0) return c;
+    if (a.store != b.store) return a.store < b.store ? -1 : 1;
+    return a.index < b.index ? -1 : a.index > b.index;
+}
+
+vector<UniversityStores::Ref> UniversityStores::sorted(ThreadPool &pool) {
+    vector<vector<uint32_t>> runs;
+    for (auto &src : sources) runs.push_back(src->sorted(pool));
+    vector<Ref> out;
+    out.reserve(size());
+    vector<size_t> pos(runs.size(), 0);
+    while (true) {
+        int best = -1;
+        for (size_t k = 0; k < runs.size(); ++k) {
+            if (pos[k] >= runs[k].size()) continue;
+            if (best < 0 || compare(Ref{(Store)k, runs[k][pos[k]]}, Ref{(Store)best, runs[best][pos[best]]}, true) < 0)
+                best = (int)k;
+        }
+        if (best < 0) break;
+        out.push_back(Ref{(Store)best, runs[best][pos[best]++]});
+    }
+    return out;
+}
+
+vector<pair<UniversityStores::Ref, Grade>> UniversityStores::top_for_course(const CourseID &c, Grade threshold) {
+    Metrics::Timer timer(Phase::Query);
+    vector<pair<Ref, Grade>> out;
+    for (size_t k = 0; k < sources.size(); ++k)
+        for (auto &p : sources[k]->top_for_course(c, threshold)) out.push_back({Ref{(Store)k, p.student}, p.grade});
+    sort(out.begin(), out.end(), [&](const pair<Ref, Grade> &x, const pair<Ref, Grade> &y) {
+        if (x.second != y.second) return x.second > y.second;
+        return compare(x.first, y.first, false) < 0;
+    });
+    return out;
+}
+
+optional<UniversityStores::Ref> UniversityStores::find(const RollID &r) {
+    for (size_t k = 0; k < sources.size(); ++k)
+        if (auto i = sources[k]->find(r)) return Ref{(Store)k, *i};
+    return nullopt;
+}
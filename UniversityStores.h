@@ -0,0 +1,84 @@
+#ifndef UNIVERSITYSTORES_H
+#define UNIVERSITYSTORES_H
+
+#include "StudentT.h"
+#include "CourseIndex.h"
+#include "RollIndex.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <unordered_set>
+
+// Type-erased read view of one store. Callers can walk the IIIT, IIT and
+// mixed stores alike through it; only this thin layer is virtual, while the
+// work behind each call runs on the concrete type. Indices are the store's own.
+class StudentSource {
+public:
+    virtual ~StudentSource() = default;
+    virtual const char* label() const = 0;
+    virtual size_t size() const = 0;
+    virtual const string& name(uint32_t i) const = 0;
+    // Printed roll; integer rolls are formatted into buf.
+    virtual string_view roll(uint32_t i, char (&buf)[24]) const = 0;
+    virtual string brief(uint32_t i) const = 0;
+    virtual vector<uint32_t> sorted(ThreadPool &pool) const = 0;
+    // These build the store's indexes on first use.
+    virtual vector<Posting> top_for_course(const CourseID &c, Grade threshold) = 0;
+    virtual optional<uint32_t> find(const RollID &r) = 0;
+};
+
+// Students split by university. IIIT-Delhi rows (integer roll, text course
+// codes) and IIT-Delhi rows (text roll, integer course codes) go to typed
+// stores. Rows that fit neither, such as a text roll with text codes or a
+// course list mixing both kinds, keep the variant-based Student.
+class UniversityStores {
+public:
+    enum Store : uint8_t { IIIT, IIT, Mixed };
+    // A record of one of the stores.
+    struct Ref {
+        Store store;
+        uint32_t index;
+    };
+
+    UniversityStore<IIITStudent> iiit;
+    UniversityStore<IITStudent> iit;
+    vector<Student> mixed;
+
+    UniversityStores();
+    ~UniversityStores();
+    UniversityStores(const UniversityStores&) = delete;
+    UniversityStores& operator=(const UniversityStores&) = delete;
+
+    // Parses the CSV on `threads` threads (0 = hardware_concurrency) and
+    // routes each row to its store; every store keeps file order. Records
+    // whose roll is in dropped are skipped and added ones follow the file,
+    // as Journal::changes describes a replay. Returns the number of records
+    // loaded.
+    size_t load_csv(const string &filename, unsigned threads = 0, const unordered_set<string> &dropped = {},
+                    const vector<Student> &added = {});
+    // Routes one record.
+    void add(const Student &s);
+    // Drops every record with roll r from the stores; returns how many.
+    size_t remove(const RollID &r);
+    size_t size() const { return iiit.size() + iit.size() + mixed.size(); }
+
+    StudentSource& source(Store s) { return *sources[s]; }
+    // Every record by name, then roll: each store is sorted on its own type
+    // and the three runs are merged.
+    vector<Ref> sorted(ThreadPool &pool);
+    // Grade >= threshold in course c across the stores, best first, ties by roll.
+    vector<pair<Ref, Grade>> top_for_course(const CourseID &c, Grade threshold);
+    optional<Ref> find(const RollID &r);
+private:
+    CourseIndex mixedCourses;
+    RollIndex mixedRolls;
+    bool mixedIndexed = false;
+    vector<unique_ptr<StudentSource>> sources;
+    class Router;
+    unique_ptr<Router> router;
+
+    friend class MixedSource;
+    void ensure_mixed_index();
+    int compare(const Ref &a, const Ref &b, bool byName);
+};
+
+#endif
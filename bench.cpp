@@ -0,0 +1,192 @@
+// bench.cpp
+// Benchmark suite for the ERP hot paths
+// Usage: ./erp_bench [--reps N] [--warmup N] [--data-dir DIR] [rows ...]
+//        (default rows: 3000 100000 1000000 10000000)
+// Generates each dataset once with gen_students, then times load_csv (mapped
+// and pipelined), parallel_sort_indices, CourseIndex::build_from,
+// top_students_for_course, StudentStore::build_from, load_csv (mapped and
+// pipelined) and sorted, and save_all_students_to_csv. Prints one JSON
+// document on stdout, with heap bytes per student as vector<Student> and as
+// StudentStore.
+
+#include "ERPUtils.h"
+#include "CourseIndex.h"
+#include "StudentStore.h"
+#include <iostream>
+#include <sstream>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using clk = chrono::steady_clock;
+
+struct OpResult {
+    string name;
+    vector<double> ms;
+    size_t rows = 0;
+};
+
+static double percentile(vector<double> v, double p) {
+    sort(v.begin(), v.end());
+    size_t rank = (size_t)max(1.0, (double)(p / 100.0 * v.size() + 0.999999));
+    return v[min(rank, v.size()) - 1];
+}
+
+static long peak_rss_kb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static bool file_exists(const string &f) {
+    struct stat sb;
+    return stat(f.c_str(), &sb) == 0;
+}
+
+static size_t file_size(const string &f) {
+    struct stat sb;
+    return stat(f.c_str(), &sb) == 0 ? (size_t)sb.st_size : 0;
+}
+
+// Runs warmup + reps iterations of fn; setup runs untimed before each iteration.
+static OpResult run_op(const string &name, size_t rows, int warmup, int reps,
+                       const function<void()> &setup, const function<void()> &fn) {
+    OpResult r;
+    r.name = name;
+    r.rows = rows;
+    for (int i = 0; i < warmup + reps; ++i) {
+        setup();
+        auto st = clk::now();
+        fn();
+        double ms = chrono::duration<double, milli>(clk::now() - st).count();
+        if (i >= warmup) r.ms.push_back(ms);
+    }
+    cerr << "  " << name << ": median " << percentile(r.ms, 50) << " ms\n";
+    return r;
+}
+
+static string gen_dataset(const string &dir, const string &gen, size_t rows) {
+    string path = dir + "/students_" + to_string(rows) + ".csv";
+    if (file_exists(path)) return path;
+    cerr << "Generating " << rows << " rows into " << path << "...\n";
+    string cmd = "'" + gen + "' " + to_string(rows) + " --seed 1 --out '" + path + "' > /dev/null";
+    if (system(cmd.c_str()) != 0) return "";
+    return path;
+}
+
+int main(int argc, char** argv) {
+    int reps = 5, warmup = 1;
+    string dir = "bench_data";
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--reps" && i + 1 < argc) reps = max(1, atoi(argv[++i]));
+        else if (a == "--warmup" && i + 1 < argc) warmup = max(0, atoi(argv[++i]));
+        else if (a == "--data-dir" && i + 1 < argc) dir = argv[++i];
+        else {
+            try { sizes.push_back(stoull(a)); }
+            catch (...) { cerr << "Usage: " << argv[0] << " [--reps N] [--warmup N] [--data-dir DIR] [rows ...]\n"; return 1; }
+        }
+    }
+    if (sizes.empty()) sizes = {3000, 100000, 1000000, 10000000};
+
+    mkdir(dir.c_str(), 0755);
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) return 1;
+    if (dir[0] != '/') dir = string(cwd) + "/" + dir;
+    string exe = argv[0];
+    string gen = (exe.find('/') == string::npos ? string(cwd) : exe.substr(0, exe.rfind('/')))
+               + "/gen_students";
+    if (gen[0] != '/') gen = string(cwd) + "/" + gen;
+
+    stringstream js;
+    js << "{\n  \"threads\": " << thread::hardware_concurrency()
+       << ",\n  \"reps\": " << reps << ",\n  \"warmup\": " << warmup << ",\n  \"datasets\": [";
+
+    for (size_t si = 0; si < sizes.size(); ++si) {
+        size_t n = sizes[si];
+        string csv = gen_dataset(dir, gen, n);
+        if (csv.empty()) { cerr << "Error: could not generate " << n << " rows\n"; return 1; }
+        cerr << "Dataset " << csv << "\n";
+
+        vector<OpResult> results;
+        vector<Student> students;
+        results.push_back(run_op("load_csv", n, warmup, reps,
+            [&]() { students.clear(); students.shrink_to_fit(); },
+            [&]() { ERPUtils::load_csv(csv, students, 0, nullptr, ReadMode::Mapped); }));
+        size_t rows = students.size();
+        results.push_back(run_op("load_csv (pipelined)", n, warmup, reps,
+            [&]() { students.clear(); students.shrink_to_fit(); },
+            [&]() { ERPUtils::load_csv(csv, students, 0, nullptr, ReadMode::Pipelined); }));
+        if (students.size() != rows) cerr << "warning: pipelined load returned " << students.size() << " rows\n";
+
+        vector<size_t> idx;
+        results.push_back(run_op("parallel_sort_indices", rows, warmup, reps,
+            [&]() { idx.resize(rows); iota(idx.begin(), idx.end(), 0); },
+            [&]() { SortTimings st; ERPUtils::parallel_sort_indices(idx, students, st); }));
+
+        CourseIndex cidx;
+        results.push_back(run_op("CourseIndex::build_from", rows, warmup, reps,
+            []() {}, [&]() { cidx.build_from(students); }));
+
+        // One query per course at a typical threshold; rows/s counts students returned.
+        auto courses = cidx.get_all_courses();
+        size_t hits = 0;
+        for (auto &c : courses) hits += cidx.top_students_for_course(c, 9.0).size();
+        results.push_back(run_op("top_students_for_course", hits, warmup, reps,
+            []() {}, [&]() {
+                size_t h = 0;
+                for (auto &c : courses) h += cidx.top_students_for_course(c, 9.0).size();
+                if (h != hits) cerr << "warning: query result changed\n";
+            }));
+
+        StudentStore store;
+        results.push_back(run_op("StudentStore::build_from", rows, warmup, reps,
+            []() {}, [&]() { store.build_from(students); }));
+        {
+            StudentStore loaded;
+            results.push_back(run_op("StudentStore::load_csv", rows, warmup, reps,
+                [&]() { loaded.clear(); }, [&]() { loaded.load_csv(csv, 0, ReadMode::Mapped); }));
+            results.push_back(run_op("StudentStore::load_csv (pipelined)", rows, warmup, reps,
+                [&]() { loaded.clear(); }, [&]() { loaded.load_csv(csv, 0, ReadMode::Pipelined); }));
+            if (loaded.size() != rows) cerr << "warning: StudentStore::load_csv returned " << loaded.size() << " rows\n";
+        }
+        vector<uint32_t> order;
+        {
+            ThreadPool pool(max(1u, thread::hardware_concurrency()));
+            results.push_back(run_op("StudentStore::sorted", rows, warmup, reps,
+                []() {}, [&]() { order = store.sorted(pool); }));
+        }
+        double studentBytes = rows ? (double)StudentStore::heap_bytes(students) / rows : 0;
+        double storeBytes = rows ? (double)store.memory_usage().total() / rows : 0;
+
+        string out = dir + "/bench_save.csv";
+        results.push_back(run_op("save_all_students_to_csv", rows, warmup, reps,
+            []() {}, [&]() { ERPUtils::save_all_students_to_csv(students, out); }));
+        remove(out.c_str());
+
+        js << (si ? "," : "") << "\n    {\n      \"rows\": " << rows << ",\n      \"bytes\": " << file_size(csv)
+           << ",\n      \"peak_rss_kb\": " << peak_rss_kb()
+           << ",\n      \"bytes_per_student\": {\"Student\": " << studentBytes << ", \"StudentStore\": " << storeBytes
+           << "},\n      \"ops\": {";
+        for (size_t k = 0; k < results.size(); ++k) {
+            auto &r = results[k];
+            double med = percentile(r.ms, 50);
+            js << (k ? "," : "") << "\n        \"" << r.name << "\": {\"median_ms\": " << med
+               << ", \"p99_ms\": " << percentile(r.ms, 99)
+               << ", \"rows_per_s\": " << (med > 0 ? (long long)(r.rows / (med / 1000.0)) : 0) << "}";
+        }
+        js << "\n      }\n    }";
+    }
+    js << "\n  ]\n}\n";
+    cout << js.str();
+    return 0;
+}
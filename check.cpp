@@ -0,0 +1,311 @@
+// check.cpp
+// Randomized consistency checks for the incrementally maintained structures
+// Usage: ./erp_check [--seed N] [--ops N]
+// Each check applies a random sequence of adds and deletes (swap-and-pop, as
+// main.cpp does) and compares the structure with one rebuilt from scratch;
+// the journal check compares replay with compaction on the same operations
+// and the store check compares StudentStore::load_csv with ERPUtils::load_csv.
+// Exits non-zero at the first mismatch.
+
+#include "CourseIndex.h"
+#include "RollIndex.h"
+#include "RankTable.h"
+#include "Journal.h"
+#include "ERPUtils.h"
+#include "StudentStore.h"
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace std;
+
+// Small vocabularies, so rolls, courses and grades collide often.
+static Student random_student(mt19937_64 &rng) {
+    static const char *names[] = {"Asha Rao", "Vikram Shah", "Neha Gupta", "Arjun Mehta", "Kavya Nair"};
+    static const char *branches[] = {"CSE", "ECE", "ME"};
+    RollID roll = rng() % 3 ? RollID((uint64_t)(2020000 + rng() % 300)) : RollID("MT" + to_string(rng() % 100));
+    Student s(roll, names[rng() % 5], branches[rng() % 3], 2019 + (int)(rng() % 3));
+    int n = (int)(rng() % 6);
+    for (int i = 0; i < n; ++i) {
+        CourseID c = rng() % 2 ? CourseID((int)(101 + rng() % 6)) : CourseID("CS10" + to_string(rng() % 6));
+        s.add_course(c, (double)(rng() % 21) / 2, rng() % 3 != 0);
+    }
+    return s;
+}
+
+// Hooks a check passes to mutate().
+struct Hooks {
+    function<void(uint32_t)> added;                // after students.push_back
+    function<void(uint32_t, uint32_t)> removing;   // (i, last) before students[last] moves into i
+    function<void(uint32_t, uint32_t)> removed;    // (i, last) after the move and pop_back
+    function<bool()> verify;
+};
+
+// Runs ops random adds and deletes from 200 random students, verifying every
+// 16 operations and at the end.
+static bool mutate(const char *what, mt19937_64 &rng, size_t ops, vector<Student> &students, const Hooks &h) {
+    for (size_t op = 0; op < ops; ++op) {
+        if (students.empty() || rng() % 2) {
+            students.push_back(random_student(rng));
+            if (h.added) h.added((uint32_t)students.size() - 1);
+        } else {
+            uint32_t i = (uint32_t)(rng() % students.size()), last = (uint32_t)students.size() - 1;
+            if (h.removing) h.removing(i, last);
+            if (i != last) students[i] = move(students[last]);
+            students.pop_back();
+            if (h.removed) h.removed(i, last);
+        }
+        if ((op % 16 == 15 || op + 1 == ops) && !h.verify()) {
+            cerr << what << ": mismatch after operation " << op + 1 << "\n";
+            return false;
+        }
+    }
+    cout << what << ": ok (" << ops << " operations, " << students.size() << " students)\n";
+    return true;
+}
+
+static vector<Student> seed_students(mt19937_64 &rng) {
+    vector<Student> students;
+    for (int i = 0; i < 200; ++i) students.push_back(random_student(rng));
+    return students;
+}
+
+// Every posting list, in order, matches a fresh build.
+static bool check_course_index(mt19937_64 &rng, size_t ops) {
+    vector<Student> students = seed_students(rng);
+    CourseIndex idx;
+    idx.build_from(students);
+    Hooks h;
+    h.added = [&](uint32_t i) { idx.insert(i); };
+    h.removing = [&](uint32_t i, uint32_t last) {
+        idx.erase(i);
+        if (i != last) idx.erase(last);
+    };
+    h.removed = [&](uint32_t i, uint32_t last) { if (i != last) idx.insert(i); };
+    h.verify = [&]() {
+        CourseIndex fresh;
+        fresh.build_from(students);
+        auto courses = fresh.get_all_courses();
+        if (idx.get_all_courses() != courses) return false;
+        for (auto &c : courses) {
+            auto a = idx.grade_range(c, -1e300, 1e300), b = fresh.grade_range(c, -1e300, 1e300);
+            if (a.second - a.first != b.second - b.first) return false;
+            for (auto p = a.first, q = b.first; p != a.second; ++p, ++q)
+                if (p->grade != q->grade || p->student != q->student) return false;
+        }
+        return true;
+    };
+    return mutate("CourseIndex", rng, ops, students, h);
+}
+
+// Every roll of the vocabulary is found exactly when some student holds it,
+// at an index holding that roll.
+static bool check_roll_index(mt19937_64 &rng, size_t ops) {
+    vector<Student> students = seed_students(rng);
+    RollIndex idx;
+    idx.build_from(students);
+    Hooks h;
+    h.added = [&](uint32_t i) { idx.insert(i); };
+    h.removing = [&](uint32_t i, uint32_t last) {
+        idx.erase(i);
+        if (i != last) idx.relocate(last, i);
+    };
+    h.verify = [&]() {
+        if (idx.size() != students.size()) return false;
+        vector<RollID> rolls;
+        for (uint64_t r = 2020000; r < 2020300; ++r) rolls.push_back(r);
+        for (int r = 0; r < 100; ++r) rolls.push_back("MT" + to_string(r));
+        for (auto &r : rolls) {
+            bool held = false;
+            for (auto &s : students) if (s.get_roll() == r) { held = true; break; }
+            auto hit = idx.find_by_roll(r);
+            if (hit.has_value() != held) return false;
+            if (hit && (*hit >= students.size() || students[*hit].get_roll() != r)) return false;
+        }
+        return true;
+    };
+    return mutate("RollIndex", rng, ops, students, h);
+}
+
+// CGPA, rank and group sizes of every student and top k of every group
+// (for several k, so the Fenwick descent is exercised) match a fresh build.
+static bool check_rank_table(mt19937_64 &rng, size_t ops) {
+    vector<Student> students = seed_students(rng);
+    RankTable ranks;
+    ranks.build_from(students);
+    Hooks h;
+    h.added = [&](uint32_t i) { ranks.insert(i); };
+    h.removing = [&](uint32_t i, uint32_t last) {
+        ranks.erase(i);
+        if (i != last) ranks.relocate(last, i);
+    };
+    h.verify = [&]() {
+        RankTable fresh;
+        fresh.build_from(students);
+        for (uint32_t i = 0; i < students.size(); ++i)
+            if (ranks.cgpa(i) != fresh.cgpa(i) || ranks.rank_of(i) != fresh.rank_of(i)) return false;
+        for (string branch : {"CSE", "ECE", "ME"})
+            for (int year = 2019; year <= 2021; ++year) {
+                size_t n = fresh.group_size(branch, year);
+                if (ranks.group_size(branch, year) != n) return false;
+                for (size_t k : {(size_t)1, (size_t)5, n / 2, n, n + 3})
+                    if (ranks.top_k(branch, year, k) != fresh.top_k(branch, year, k)) return false;
+            }
+        return true;
+    };
+    return mutate("RankTable", rng, ops, students, h);
+}
+
+static vector<string> lines_of(const vector<Student> &students) {
+    vector<string> out;
+    for (auto &s : students) out.push_back(ERPUtils::format_student(s));
+    return out;
+}
+
+// Journal semantics on a plain vector: an add, update or delete drops every
+// record with the roll, and an add or update appends the new one.
+static void apply_op(vector<Student> &model, char op, const Student &s) {
+    string roll = to_string_variant(s.get_roll());
+    model.erase(remove_if(model.begin(), model.end(), [&](const Student &m) {
+        return to_string_variant(m.get_roll()) == roll;
+    }), model.end());
+    if (op != 'D') model.push_back(s);
+}
+
+// Replaying the journal over the base gives the same records in the same
+// order as compacting it into the base (CSV and snapshot), also when
+// operations arrive while a compaction runs; the records match the model.
+// A journal is not applied to a base regenerated under it.
+static bool check_journal(mt19937_64 &rng, size_t ops) {
+    char dir[] = "/tmp/erp_check.XXXXXX";
+    if (!mkdtemp(dir)) { cerr << "Journal: cannot create a temp directory\n"; return false; }
+    string csv = string(dir) + "/students.csv", snap = ERPUtils::snapshot_path(csv);
+    vector<Student> model = seed_students(rng);
+    ERPUtils::save_all_students_to_csv(model, csv);
+    ERPUtils::save_snapshot(model, snap);
+
+    auto log_ops = [&](Journal &j, size_t n) {
+        for (size_t k = 0; k < n; ++k) {
+            Student s = random_student(rng);
+            int kind = (int)(rng() % 3);
+            if (kind == 0) { j.log_add(s); apply_op(model, 'A', s); }
+            else if (kind == 1) { j.log_update(s); apply_op(model, 'U', s); }
+            else { j.log_delete(s.get_roll()); apply_op(model, 'D', s); }
+        }
+    };
+    auto load = [&](Journal &j, bool fromSnapshot) {
+        vector<Student> v;
+        if (fromSnapshot) ERPUtils::load_snapshot(snap, v);
+        else ERPUtils::load_csv(csv, v);
+        j.replay(v);
+        return lines_of(v);
+    };
+    auto sorted_lines = [](vector<string> v) { sort(v.begin(), v.end()); return v; };
+
+    bool ok = true, stale = false;
+    size_t done = 0, rounds = 0;
+    {
+        Journal j(csv);
+        while (ok && done < ops) {
+            size_t n = min<size_t>(64, ops - done);
+            log_ops(j, n / 2);
+            auto replayed = load(j, false);
+            j.compact_async();
+            j.wait();
+            ok = load(j, false) == replayed && load(j, true) == replayed;
+            // Operations logged while the compaction runs land in the new journal.
+            j.compact_async();
+            log_ops(j, n - n / 2);
+            j.wait();
+            auto after = load(j, false);
+            ok = ok && load(j, true) == after && sorted_lines(after) == sorted_lines(lines_of(model));
+            done += n;
+            ++rounds;
+        }
+        // Regenerating the base leaves a journal that describes another file:
+        // it is ignored on load and started over by the next operation.
+        model = seed_students(rng);
+        ERPUtils::save_all_students_to_csv(model, csv);
+        stale = sorted_lines(load(j, false)) != sorted_lines(lines_of(model));
+        log_ops(j, 16);
+        stale = stale || sorted_lines(load(j, false)) != sorted_lines(lines_of(model));
+    }
+    for (string f : {csv, snap, csv + ".journal", csv + ".journal.compacting"}) remove(f.c_str());
+    rmdir(dir);
+    if (!ok) {
+        cerr << "Journal: replay and compaction disagree in round " << rounds << "\n";
+        return false;
+    }
+    if (stale) {
+        cerr << "Journal: a journal of the replaced base was applied to the new one\n";
+        return false;
+    }
+    cout << "Journal: ok (" << done << " operations, " << rounds << " compactions, " << model.size() << " students)\n";
+    return true;
+}
+
+// StudentStore::load_csv reads the same records, in the same order, as
+// ERPUtils::load_csv on 1 to 4 threads, mapped and pipelined. The file spans
+// more than one pipelined block and has more than 255 branches and grades that
+// are not hundredths, so the side tables are merged too.
+static bool check_store_load(mt19937_64 &rng) {
+    char dir[] = "/tmp/erp_check.XXXXXX";
+    if (!mkdtemp(dir)) { cerr << "StudentStore: cannot create a temp directory\n"; return false; }
+    string csv = string(dir) + "/students.csv";
+    {
+        // Written by hand: the CSV writer rounds grades.
+        ofstream out(csv);
+        for (int i = 0; i < 150000; ++i) {
+            Student s = random_student(rng);
+            if (rng() % 8) { out << ERPUtils::format_student(s) << "\n"; continue; }
+            out << to_string_variant(s.get_roll()) << "," << s.get_name() << ",B" << rng() % 400 << ","
+                << s.get_startYear() << "," << rng() % 70000 << ":" << to_string((double)(rng() % 100000) / 9973) << ",\n";
+        }
+    }
+    vector<Student> students;
+    ERPUtils::load_csv(csv, students);
+
+    auto same = [](const Student &a, const Student &b) {
+        return ERPUtils::format_student(a) == ERPUtils::format_student(b) && a.get_branch() == b.get_branch()
+            && a.get_courses() == b.get_courses() && a.get_prevCourses() == b.get_prevCourses();
+    };
+    bool ok = true;
+    for (ReadMode mode : {ReadMode::Mapped, ReadMode::Pipelined})
+        for (unsigned threads = 1; ok && threads <= 4; ++threads) {
+            StudentStore store;
+            ok = store.load_csv(csv, threads, mode) == students.size() && store.size() == students.size();
+            for (size_t i = 0; ok && i < students.size(); ++i) ok = same(store[i].to_student(), students[i]);
+            if (!ok) cerr << "StudentStore: load_csv differs from ERPUtils::load_csv on " << threads << " threads ("
+                          << (mode == ReadMode::Mapped ? "mapped" : "pipelined") << ")\n";
+        }
+    remove(csv.c_str());
+    rmdir(dir);
+    if (ok) cout << "StudentStore: ok (" << students.size() << " students)\n";
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint64_t seed = 1;
+    size_t ops = 2000;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--seed" && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--ops" && i + 1 < argc) ops = strtoull(argv[++i], nullptr, 10);
+        else {
+            cerr << "Usage: " << argv[0] << " [--seed N] [--ops N]\n";
+            return 1;
+        }
+    }
+    mt19937_64 rng(seed);
+    bool ok = check_course_index(rng, ops);
+    ok = check_roll_index(rng, ops) && ok;
+    ok = check_rank_table(rng, ops) && ok;
+    ok = check_journal(rng, ops) && ok;
+    ok = check_store_load(rng) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// erp_client.cpp
+// Client and load generator for the erp query server (./erp --serve / --port)
+// Usage: ./erp_client [--socket PATH | --port N] [COMMAND ...]
+//          sends each command (or each stdin line when none are given) and prints the replies
+//        ./erp_client [--socket PATH | --port N] --load [--clients C] [--requests N] [--commands FILE]
+//          C concurrent connections each send N requests, cycling through the
+//          commands (default: a mix of TOP, QUERY, NAME and FIND), and report
+//          QPS and p50/p99/max latency
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace std;
+using clk = chrono::steady_clock;
+
+struct Target {
+    string socket_path = "erp.sock";
+    int port = 0;
+};
+
+static int connect_to(const Target &t) {
+    int fd;
+    if (t.port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)t.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+    } else {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, t.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+    }
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+// Buffered request/reply over one connection.
+class Connection {
+private:
+    int fd;
+    string buf;
+    bool read_line(string &line) {
+        size_t nl;
+        while ((nl = buf.find('\n')) == string::npos) {
+            char tmp[65536];
+            ssize_t n = read(fd, tmp, sizeof(tmp));
+            if (n <= 0) return false;
+            buf.append(tmp, (size_t)n);
+        }
+        line = buf.substr(0, nl);
+        buf.erase(0, nl + 1);
+        return true;
+    }
+public:
+    explicit Connection(int f) : fd(f) {}
+    ~Connection() { close(fd); }
+    // Sends one request and collects the reply lines (status line first).
+    bool call(const string &request, vector<string> &reply) {
+        reply.clear();
+        string msg = request + "\n";
+        for (size_t off = 0; off < msg.size();) {
+            ssize_t w = send(fd, msg.data() + off, msg.size() - off, MSG_NOSIGNAL);
+            if (w <= 0) return false;
+            off += (size_t)w;
+        }
+        string line;
+        if (!read_line(line)) return false;
+        reply.push_back(line);
+        if (line.compare(0, 3, "OK ") != 0) return true;
+        for (long n = atol(line.c_str() + 3); n > 0; --n) {
+            if (!read_line(line)) return false;
+            reply.push_back(line);
+        }
+        return true;
+    }
+};
+
+static double pct(const vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)max(1.0, p / 100.0 * sorted.size() + 0.999999);
+    return sorted[min(rank, sorted.size()) - 1];
+}
+
+static int run_load(const Target &t, size_t clients, size_t requests, const vector<string> &commands) {
+    vector<vector<double>> lat(clients);
+    atomic<size_t> failed{0};
+    vector<thread> threads;
+    auto start = clk::now();
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            int fd = connect_to(t);
+            if (fd < 0) { failed += requests; return; }
+            Connection conn(fd);
+            vector<string> reply;
+            lat[c].reserve(requests);
+            for (size_t i = 0; i < requests; ++i) {
+                auto t0 = clk::now();
+                if (!conn.call(commands[(c + i) % commands.size()], reply)) { failed += requests - i; return; }
+                lat[c].push_back(chrono::duration<double, micro>(clk::now() - t0).count());
+                if (reply[0].compare(0, 2, "OK") != 0) failed++;
+            }
+        });
+    }
+    for (auto &th : threads) th.join();
+    double secs = chrono::duration<double>(clk::now() - start).count();
+    vector<double> all;
+    for (auto &l : lat) all.insert(all.end(), l.begin(), l.end());
+    sort(all.begin(), all.end());
+    cout << clients << " clients, " << all.size() << " requests in " << secs << " s: " << (long long)(all.size() / secs)
+         << " QPS, p50 " << pct(all, 50) << " us, p99 " << pct(all, 99) << " us, max " << (all.empty() ? 0 : all.back())
+         << " us, " << failed << " failed\n";
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    Target t;
+    bool load = false;
+    size_t clients = 4, requests = 1000;
+    string commands_file;
+    vector<string> commands;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--socket" && i + 1 < argc) t.socket_path = argv[++i];
+        else if (a == "--port" && i + 1 < argc) t.port = atoi(argv[++i]);
+        else if (a == "--load") load = true;
+        else if (a == "--clients" && i + 1 < argc) clients = max(1, atoi(argv[++i]));
+        else if (a == "--requests" && i + 1 < argc) requests = max(1, atoi(argv[++i]));
+        else if (a == "--commands" && i + 1 < argc) commands_file = argv[++i];
+        else if (a.size() > 1 && a[0] == '-' && a[1] == '-') {
+            cerr << "Usage: " << argv[0] << " [--socket PATH | --port N] [COMMAND ...]\n"
+                 << "       " << argv[0] << " [--socket PATH | --port N] --load [--clients C] [--requests N] [--commands FILE]\n";
+            return 1;
+        }
+        else commands.push_back(a);
+    }
+    if (!commands_file.empty()) {
+        ifstream in(commands_file);
+        for (string line; getline(in, line);) if (!line.empty() && line[0] != '#') commands.push_back(line);
+    }
+
+    if (load) {
+        if (commands.empty()) commands = {"TOP CS101 9.0 20", "QUERY CS101>=8 AND 201>=8", "NAME mehta", "FIND 2019002",
+                                          "TOP 201 9.5 20", "NAME Advit Mehta", "RANK 2019003", "QUERY ML301>9 AND NOT CS101"};
+        return run_load(t, clients, requests, commands);
+    }
+
+    int fd = connect_to(t);
+    if (fd < 0) {
+        cerr << "Error: cannot connect to " << (t.port ? "127.0.0.1:" + to_string(t.port) : t.socket_path) << "\n";
+        return 1;
+    }
+    Connection conn(fd);
+    vector<string> reply;
+    auto send_one = [&](const string &cmd) {
+        if (!conn.call(cmd, reply)) { cerr << "Error: connection closed\n"; return false; }
+        for (auto &l : reply) cout << l << "\n";
+        return true;
+    };
+    if (commands.empty()) {
+        for (string line; getline(cin, line);) if (!line.empty() && !send_one(line)) return 1;
+    } else {
+        for (auto &cmd : commands) if (!send_one(cmd)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+// erp_convert.cpp
+// Converts between the text CSV and the binary columnar snapshot format
+// Usage: ./erp_convert <in.csv> <out.snap>
+//        ./erp_convert <in.snap> <out.csv>
+
+#include "ERPUtils.h"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+static bool ends_with(const string &s, const string &suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <in.csv> <out.snap> | <in.snap> <out.csv>\n";
+        return 1;
+    }
+    string in = argv[1], out = argv[2];
+    auto st = chrono::high_resolution_clock::now();
+    size_t n;
+    if (ends_with(in, ".snap")) n = ERPUtils::convert_snapshot_to_csv(in, out);
+    else n = ERPUtils::convert_csv_to_snapshot(in, out);
+    auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - st).count();
+    if (n == 0) {
+        cerr << "Error: nothing converted from " << in << "\n";
+        return 1;
+    }
+    cout << "Converted " << n << " records: " << in << " -> " << out << " (" << ms << " ms)\n";
+    return 0;
+}
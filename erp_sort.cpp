@@ -0,0 +1,41 @@
+// erp_sort.cpp
+// Sorts a student CSV by name, then roll, using bounded memory
+// Usage: ./erp_sort <in.csv> <out.csv> [--mem MB] [--threads N] [--tmp DIR]
+
+#include "ExternalSort.h"
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <in.csv> <out.csv> [--mem MB] [--threads N] [--tmp DIR]\n";
+        return 1;
+    }
+    string in = argv[1], out = argv[2];
+    ExternalSort::Options opt;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        if (flag == "--mem") opt.memory_bytes = (size_t)strtoull(argv[i + 1], nullptr, 10) << 20;
+        else if (flag == "--threads") opt.threads = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+        else if (flag == "--tmp") opt.temp_dir = argv[i + 1];
+        else {
+            cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if ((argc - 3) % 2 != 0) {
+        cerr << "Missing value for " << argv[argc - 1] << "\n";
+        return 1;
+    }
+    ExternalSort::Stats st;
+    if (!ExternalSort::sort_csv(in, out, opt, &st)) {
+        cerr << "Error: could not sort " << in << " into " << out << "\n";
+        return 1;
+    }
+    cout << "Sorted " << st.rows << " records (" << st.skipped << " skipped, " << st.bytes / (1 << 20) << " MB): "
+         << in << " -> " << out << "\n";
+    cout << st.runs << " runs in " << st.run_ms << " ms, " << st.merge_passes << " merge passes in " << st.merge_ms << " ms\n";
+    return 0;
+}
@@ -1,14 +1,26 @@
 // gen_students.cpp
 // Generates CSV file with student records for testing
-// Usage: ./gen_students <count>   (default: 3000)
-// Output: students.csv
+// Usage: ./gen_students <count> [--seed S] [--threads T] [--out FILE] [--by-university]
+//   count     number of records (default: 3000)
+//   --seed    RNG seed; the same seed always produces byte-identical output
+//             (default: taken from the clock)
+//   --threads generator threads (default: hardware concurrency)
+//   --out     output file (default: students.csv)
+//   --by-university  integer rolls take only text course codes (IIIT-Delhi)
+//             and text rolls only integer codes (IIT-Delhi); by default
+//             every record mixes both kinds
+//
+// Records are produced in fixed-size shards, each with its own RNG stream
+// derived from (seed, shard number), so the output does not depend on the
+// thread count. Shards are formatted into large buffers by worker threads
+// and written in order by the main thread.
 
 #include <bits/stdc++.h>
 #include <cstring>
 using namespace std;
 
 // Generate varied names
-string rand_name(int id) {
+string rand_name(long long id) {
     static vector<string> first = {
         "Aarav","Aditi","Advait","Aisha","Akash","Ananya","Ankit","Anushka",
         "Arjun","Divya","Gaurav","Isha","Karan","Kavya","Mihir","Neha",
@@ -20,10 +32,10 @@ string rand_name(int id) {
         "Kumar","Malhotra","Mehta","Nair","Patel","Rao","Reddy","Shah",
         "Sharma","Singh","Verma","Yadav"
     };
-    
+
     int fn = (id * 7) % first.size();
     int ln = (id * 13) % last.size();
-    
+
     if (id < 100) {
         return first[fn] + " " + last[ln];
     } else {
@@ -31,152 +43,190 @@ string rand_name(int id) {
     }
 }
 
-// Random number generator
-mt19937_64 global_rng((unsigned)chrono::high_resolution_clock::now().time_since_epoch().count());
+// University data
+static const vector<string> branches = {"CSE","ECE","CSAI","CSSS","CSD","CB","EVE","ME","HCD"};
+
+// IIIT-Delhi style course codes (strings)
+static const vector<string> courseStrings = {
+    "CS101","CS102","CS201","CS301","MATH101","MATH102","MATH201",
+    "PH101","PH102","EE101","EE102","AI201","AI301","ML201","ML301",
+    "HSS101","HSS102","BIO101","ECO101","COM101"
+};
 
-// Random boolean with probability p
-bool coin(double p = 0.5) {
-    uniform_real_distribution<double> dist(0.0, 1.0);
-    return dist(global_rng) < p;
+// IIT-Delhi style course codes (integers)
+static const vector<string> courseInts = {"101","102","201","202","301","302","401","501","502"};
+
+static const long long SHARD_ROWS = 65536;
+static bool byUniversity = false;
+
+// SplitMix64: turns (seed, shard) into well-separated per-shard seeds.
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
 }
 
-int main(int argc, char** argv) {
-    int N = 3000;
-    if (argc >= 2) {
-        try { 
-            N = stoi(argv[1]); 
-            if (N <= 0) N = 3000;
-        }
-        catch (...) { 
-            N = 3000; 
-        }
-    }
+static void append_num(string &out, long long v) {
+    char buf[24];
+    auto res = to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
 
-    // Seed random
-    srand((unsigned)time(nullptr));
-
-    // University data
-    vector<string> branches = {"CSE","ECE","CSAI","CSSS","CSD","CB","EVE","ME","HCD"};
-    
-    // IIIT-Delhi style course codes (strings)
-    vector<string> courseStrings = {
-        "CS101","CS102","CS201","CS301","MATH101","MATH102","MATH201",
-        "PH101","PH102","EE101","EE102","AI201","AI301","ML201","ML301",
-        "HSS101","HSS102","BIO101","ECO101","COM101"
-    };
-    
-    // IIT-Delhi style course codes (integers)
-    vector<int> courseInts = {101,102,201,202,301,302,401,501,502};
+// Grade in tenths (60..100) printed as "d.d".
+static void append_grade(string &out, int tenths) {
+    append_num(out, tenths / 10);
+    out += '.';
+    out += char('0' + tenths % 10);
+}
 
-    // Random number generator setup
+// Formats records [first, last] (1-based) of the dataset into out.
+static void generate_shard(uint64_t seed, long long shard, long long first, long long last, string &out) {
+    mt19937_64 rng(splitmix64(seed ^ splitmix64((uint64_t)shard)));
+    uniform_real_distribution<double> coinDist(0.0, 1.0);
     uniform_int_distribution<int> branchDist(0, branches.size() - 1);
     uniform_real_distribution<double> gradeDist(6.0, 10.0);
     uniform_int_distribution<int> startYearDist(2018, 2023);
     uniform_int_distribution<int> courseIntDist(0, courseInts.size() - 1);
     uniform_int_distribution<int> courseStrDist(0, courseStrings.size() - 1);
+    auto coin = [&](double p) { return coinDist(rng) < p; };
+
+    out.clear();
+    out.reserve((last - first + 1) * 120);
+    for (long long i = first; i <= last; i++) {
+        // Roll number: 70% numeric, 30% string (BT-YY-NNNN). Both embed the
+        // record number in full, so rolls stay unique at any size.
+        bool intRoll = coin(0.7);
+        if (intRoll) {
+            append_num(out, 2019000 + i);
+        } else {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "BT-%02d-%04lld", (int)((i % 5) + 20), i);
+            out += buf;
+        }
+        out += ',';
+        out += rand_name(i);
+        out += ',';
+        out += branches[branchDist(rng)];
+        out += ',';
+        append_num(out, startYearDist(rng));
+
+        // Current courses (3-4) then previous courses (2-3), no course twice.
+        const string *used[8];
+        int nUsed = 0;
+        for (int part = 0; part < 2; part++) {
+            out += ',';
+            int count = (part == 0 ? 3 : 2) + (i % 2);
+            bool firstInList = true;
+            for (int j = 0; j < count; j++) {
+                int g = (int)round(gradeDist(rng) * 10.0);
+                bool intCode = byUniversity ? !intRoll : coin(0.5);
+                const string *code = intCode ? &courseInts[courseIntDist(rng)] : &courseStrings[courseStrDist(rng)];
+                if (find(used, used + nUsed, code) != used + nUsed) continue;
+                used[nUsed++] = code;
+                if (!firstInList) out += ';';
+                firstInList = false;
+                out += *code;
+                out += ':';
+                append_grade(out, g);
+            }
+        }
+        out += '\n';
+    }
+}
+
+int main(int argc, char** argv) {
+    long long N = 3000;
+    uint64_t seed = (uint64_t)chrono::high_resolution_clock::now().time_since_epoch().count();
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    string outFile = "students.csv";
+
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        try {
+            if (arg == "--seed" && a + 1 < argc) seed = stoull(argv[++a]);
+            else if (arg == "--threads" && a + 1 < argc) threads = max(1, stoi(argv[++a]));
+            else if (arg == "--out" && a + 1 < argc) outFile = argv[++a];
+            else if (arg == "--by-university") byUniversity = true;
+            else {
+                N = stoll(arg);
+                if (N <= 0) N = 3000;
+            }
+        }
+        catch (...) {
+            N = 3000;
+        }
+    }
 
     // Open output file
-    ofstream fout("students.csv");
-    if (!fout.is_open()) {
-        cerr << "Error: Cannot write students.csv\n";
+    FILE *fout = fopen(outFile.c_str(), "wb");
+    if (!fout) {
+        cerr << "Error: Cannot write " << outFile << "\n";
         return 1;
     }
 
     cout << "Generating " << N << " student records...\n";
 
-    for (int i = 1; i <= N; i++) {
-        // Generate roll number (70% numeric, 30% string format)
-        string roll;
-        if (coin(0.7)) {
-            // Numeric roll number
-            roll = to_string(2019000 + i);
-        } else {
-            // String roll number (BT-YY-XXX format)
-            char buf[64];
-            snprintf(buf, sizeof(buf), "BT-%02d-%04d", 
-                    ((i % 5) + 20), i % 10000);
-            roll = buf;
-        }
-
-        string name = rand_name(i);
-        string branch = branches[branchDist(global_rng)];
-        int startYear = startYearDist(global_rng);
-
-        // Generate current courses (3-4 courses)
-        vector<string> curr;
-        int numCurrent = 3 + (i % 2);
-        
-        set<string> usedCourses; // Avoid duplicates
-        
-        for (int j = 0; j < numCurrent; j++) {
-            double g = round(gradeDist(global_rng) * 10.0) / 10.0;
-            
-            string courseStr;
-            // 50% chance of using string or int course ID
-            if (coin()) {
-                int cIdx = courseIntDist(global_rng);
-                courseStr = to_string(courseInts[cIdx]) + ":" + to_string(g);
-            } else {
-                int cIdx = courseStrDist(global_rng);
-                courseStr = courseStrings[cIdx] + ":" + to_string(g);
+    // Workers claim shards in order; at most `window` shards are buffered
+    // ahead of the writer, which bounds memory for arbitrarily large runs.
+    long long shards = (N + SHARD_ROWS - 1) / SHARD_ROWS;
+    size_t window = threads * 2;
+    vector<string> buffers(window);
+    vector<char> ready(window, 0);
+    mutex mtx;
+    condition_variable cv;
+    long long nextShard = 0, written = 0;
+
+    auto worker = [&]() {
+        while (true) {
+            long long s;
+            {
+                unique_lock<mutex> lk(mtx);
+                cv.wait(lk, [&]() { return nextShard >= shards || nextShard < written + (long long)window; });
+                if (nextShard >= shards) return;
+                s = nextShard++;
             }
-            
-            if (usedCourses.find(courseStr.substr(0, courseStr.find(':'))) == usedCourses.end()) {
-                curr.push_back(courseStr);
-                usedCourses.insert(courseStr.substr(0, courseStr.find(':')));
+            string buf;
+            generate_shard(seed, s, s * SHARD_ROWS + 1, min(N, (s + 1) * SHARD_ROWS), buf);
+            {
+                lock_guard<mutex> lk(mtx);
+                buffers[s % window].swap(buf);
+                ready[s % window] = 1;
             }
+            cv.notify_all();
         }
-
-        // Generate previous courses (2-3 courses)
-        vector<string> prev;
-        int numPrev = 2 + (i % 2);
-        
-        for (int j = 0; j < numPrev; j++) {
-            double g = round(gradeDist(global_rng) * 10.0) / 10.0;
-            
-            string courseStr;
-            if (coin()) {
-                int cIdx = courseIntDist(global_rng);
-                courseStr = to_string(courseInts[cIdx]) + ":" + to_string(g);
-            } else {
-                int cIdx = courseStrDist(global_rng);
-                courseStr = courseStrings[cIdx] + ":" + to_string(g);
-            }
-            
-            if (usedCourses.find(courseStr.substr(0, courseStr.find(':'))) == usedCourses.end()) {
-                prev.push_back(courseStr);
-                usedCourses.insert(courseStr.substr(0, courseStr.find(':')));
-            }
+    };
+    vector<thread> pool;
+    for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker);
+
+    bool ok = true;
+    while (written < shards) {
+        string buf;
+        {
+            unique_lock<mutex> lk(mtx);
+            cv.wait(lk, [&]() { return ready[written % window] != 0; });
+            buf.swap(buffers[written % window]);
+            ready[written % window] = 0;
         }
-
-        // Helper lambda to join vector with semicolons
-        auto join = [&](vector<string>& v) {
-            string s;
-            for (size_t k = 0; k < v.size(); k++) {
-                if (k > 0) s += ";";
-                s += v[k];
-            }
-            return s;
-        };
-
-        // Write CSV line
-        fout << roll << "," 
-             << name << "," 
-             << branch << "," 
-             << startYear << "," 
-             << join(curr) << "," 
-             << join(prev) << "\n";
+        ok = ok && fwrite(buf.data(), 1, buf.size(), fout) == buf.size();
+        {
+            lock_guard<mutex> lk(mtx);
+            written++;
+        }
+        cv.notify_all();
 
         // Progress indicator
-        if (i % 500 == 0 || i == N) {
-            cout << "Progress: " << i << "/" << N << " records\r" << flush;
-        }
+        cout << "Progress: " << min(N, written * SHARD_ROWS) << "/" << N << " records\r" << flush;
+    }
+    for (auto &t : pool) t.join();
+    ok = (fclose(fout) == 0) && ok;
+    if (!ok) {
+        cerr << "\nError: write to " << outFile << " failed\n";
+        return 1;
     }
 
-    fout.close();
-
-    cout << "\nSuccessfully generated students.csv with " << N << " records\n";
+    cout << "\nSuccessfully generated " << outFile << " with " << N << " records (seed " << seed << ")\n";
     cout << "File ready for use with ERP system.\n";
-    
+
     return 0;
-}
\ No newline at end of file
+}
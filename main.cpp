@@ -4,11 +4,28 @@
 #include <numeric>
 #include <algorithm>
 #include <cstdlib>
+#include <iomanip>
+#include <sstream>
 #include "Types.h"
 #include "Student.h"
 #include "CourseIndex.h"
+#include "RollIndex.h"
+#include "Journal.h"
 #include "InputValidator.h"
 #include "ERPUtils.h"
+#include "Metrics.h"
+#include "BatchQuery.h"
+#include "QueryEngine.h"
+#include "Analytics.h"
+#include "RankTable.h"
+#include "TopK.h"
+#include "NameIndex.h"
+#include "Server.h"
+#include "UniversityStores.h"
+#include "StudentStore.h"
+#include <thread>
+#include <csignal>
+#include <fstream>
 
 using namespace std;
 
@@ -21,6 +38,7 @@ void displayMenu() {
     cout << "||    1. Create IIIT-Delhi Student (int roll, string course)             ||" << endl;
     cout << "||    2. Create IIT-Delhi Student (string roll, int course)              ||" << endl;
     cout << "||    3. Display All Students (Both Universities)                        ||" << endl;
+    cout << "||    18. View by University (typed IIIT / IIT stores, merged listing)   ||" << endl;
     cout << "||=======================================================================||" << endl;
     cout << "|| Question 3: Parallel Sorting with Threads                             ||" << endl;
     cout << "||    4. Generate Sample CSV (3000 records)                              ||" << endl;
@@ -34,8 +52,14 @@ void displayMenu() {
     cout << "|| Question 5: Fast Query by Course Grade                                ||" << endl;
     cout << "||    9. Query Students (Grade >= 9 in specific course)                  ||" << endl;
     cout << "||    10. Custom Query (Choose course and grade threshold)               ||" << endl;
+    cout << "||    13. Multi-course Query (AND / OR / NOT of course grade ranges)     ||" << endl;
+    cout << "||    14. Course Analytics (mean, std, percentiles, histograms)          ||" << endl;
+    cout << "||    15. CGPA Rankings (rank of a student / top K of a branch + year)   ||" << endl;
+    cout << "||    16. Top K in a Course (no index build needed)                      ||" << endl;
+    cout << "||    17. Search Students by Name (prefix / misspelled)                  ||" << endl;
     cout << "||=======================================================================||" << endl;
     cout << "||    11. DELETE STUDENT (Permanent)                                     ||" << endl;
+    cout << "||    12. Show Metrics (phase timings, counters, memory per student)     ||" << endl;
     cout << "||    0. Exit                                                            ||" << endl;
     cout << "||=======================================================================||" << endl;
 }
@@ -47,15 +71,80 @@ void wait_for_enter() {
     getline(cin, tmp);
 }
 
+// Everything the menu operates on. The indexes and the per-university stores
+// are built on first use and then kept in step with adds and deletes.
+struct Session {
+    string csv_file;
+    Journal journal{csv_file};
+    vector<Student> students;
+    vector<size_t> sorted_indices, input_order;
+    CourseIndex cidx;
+    RollIndex ridx;
+    RankTable ranks;
+    NameIndex nidx;
+    unique_ptr<UniversityStores> universities; // null until option 18 needs it
+    bool sorted = false, indexed = false, roll_indexed = false, ranked = false, name_indexed = false;
+
+    explicit Session(const string &csv = "students.csv") : csv_file(csv) {}
+};
+
+// Loads the binary snapshot when it is at least as new as the CSV, else the CSV itself.
+size_t load_dataset(Session& db, LoadStats* stats = nullptr) {
+    db.sorted = db.indexed = db.roll_indexed = db.ranked = db.name_indexed = false;
+    db.universities.reset();
+    if (ERPUtils::snapshot_is_fresh(db.csv_file)) {
+        size_t n = ERPUtils::load_snapshot(ERPUtils::snapshot_path(db.csv_file), db.students, 0, stats);
+        if (n > 0) return n + db.journal.replay(db.students);
+    }
+    size_t n = ERPUtils::load_csv(db.csv_file, db.students, 0, stats);
+    return n + db.journal.replay(db.students);
+}
+
+void ensure_roll_index(Session& db) {
+    if (!db.roll_indexed) { db.ridx.build_from(db.students); db.roll_indexed = true; }
+}
+
+void ensure_ranks(Session& db) {
+    if (!db.ranked) { db.ranks.build_from(db.students); db.ranked = true; }
+}
+
+void ensure_name_index(Session& db) {
+    if (!db.name_indexed) { db.nidx.build_from(db.students); db.name_indexed = true; }
+}
+
+// Built from the loaded students, or, when nothing is loaded yet, routed
+// straight from the CSV with the journal applied on top.
+UniversityStores& ensure_universities(Session& db) {
+    if (!db.universities) {
+        db.universities.reset(new UniversityStores());
+        if (db.students.empty()) {
+            unordered_set<string> dropped;
+            vector<Student> added;
+            Journal::changes(db.csv_file, dropped, added);
+            db.universities->load_csv(db.csv_file, 0, dropped, added);
+        } else {
+            for (auto &s : db.students) db.universities->add(s);
+        }
+    }
+    return *db.universities;
+}
+
 // Helpers moved from monolithic main
-void manual_add_student(vector<Student>& students, bool iiit_mode) {
+void manual_add_student(Session& db, bool iiit_mode) {
+    auto& students = db.students;
     if (students.empty()) {
         cout << "Note: Loading existing students.csv first...\n";
-        ERPUtils::load_csv("students.csv", students);
+        load_dataset(db);
     }
+    ensure_roll_index(db);
     cout << "\n--- Manual Student Creation ---\n";
     
     RollID r = InputValidator::readRollID(iiit_mode);
+    if (auto dup = db.ridx.find_by_text(to_string_variant(r))) {
+        cout << "Error: Roll number already used by " << students[*dup].brief() << "\n";
+        wait_for_enter();
+        return;
+    }
     string name = InputValidator::readString("Name: ");
     string branch = InputValidator::readString("Branch: ");
     int year = InputValidator::readYear("Start Year (YYYY): "); // Uses new 4-digit check
@@ -92,26 +181,55 @@ void manual_add_student(vector<Student>& students, bool iiit_mode) {
     }
 
     students.push_back(s);
-    ERPUtils::append_student_to_csv(s, "students.csv");
+    uint32_t h = students.size() - 1;
+    db.ridx.insert(h);
+    if (db.indexed) db.cidx.insert(h);
+    if (db.ranked) db.ranks.insert(h);
+    if (db.name_indexed) db.nidx.insert(h);
+    if (db.universities) db.universities->add(s);
+    db.journal.log_add(s);
     cout << "Student saved!\n";
     wait_for_enter();
 }
 
-void delete_student(vector<Student>& students) {
-    if (students.empty()) ERPUtils::load_csv("students.csv", students);
+// Removes students[i] by moving the last record into its slot, keeping the
+// indexes in step so they never need a rebuild.
+void remove_student(Session& db, uint32_t i) {
+    auto& students = db.students;
+    uint32_t last = students.size() - 1;
+    if (db.indexed) db.cidx.erase(i);
+    if (db.roll_indexed) db.ridx.erase(i);
+    if (db.ranked) db.ranks.erase(i);
+    if (db.name_indexed) db.nidx.erase(i);
+    if (i != last) {
+        if (db.indexed) db.cidx.erase(last);
+        if (db.roll_indexed) db.ridx.relocate(last, i);
+        if (db.ranked) db.ranks.relocate(last, i);
+        if (db.name_indexed) db.nidx.relocate(last, i);
+        students[i] = move(students[last]);
+    }
+    students.pop_back();
+    if (db.indexed && i != last) db.cidx.insert(i);
+}
+
+void delete_student(Session& db) {
+    auto& students = db.students;
+    if (students.empty()) load_dataset(db);
+    ensure_roll_index(db);
     cout << "\n--- DELETE STUDENT ---\n";
     string roll_in = InputValidator::readString("Enter Roll Number: ");
 
-    auto it = find_if(students.begin(), students.end(), [&](const Student& s) {
-        return to_string_variant(s.get_roll()) == roll_in;
-    });
-
-    if (it != students.end()) {
-        cout << "Found: " << it->brief() << "\n";
+    auto found = db.ridx.find_by_text(roll_in);
+    if (found) {
+        cout << "Found: " << students[*found].brief() << "\n";
         string confirm = InputValidator::readString("Delete Permanently? (y/n): ");
         if (confirm == "y" || confirm == "Y") {
-            students.erase(it);
-            ERPUtils::save_all_students_to_csv(students, "students.csv");
+            // The journal deletes by roll, so drop every record carrying it.
+            RollID roll = students[*found].get_roll();
+            for (; found; found = db.ridx.find_by_text(roll_in)) remove_student(db, *found);
+            if (db.universities) db.universities->remove(roll);
+            db.journal.log_delete(roll);
+            db.sorted = false;
             cout << "Deleted.\n";
         }
     } else {
@@ -120,23 +238,154 @@ void delete_student(vector<Student>& students) {
     wait_for_enter();
 }
 
-int main() {
-    string csv_file = "students.csv";
-    vector<Student> students;
-    vector<size_t> sorted_indices, input_order;
-    CourseIndex cidx;
-    bool sorted = false, indexed = false;
+void print_metrics(const string &format) {
+    if (format.empty()) return;
+    auto snap = Metrics::snapshot();
+    cerr << (format == "json" ? snap.to_json() : snap.to_text());
+}
+
+// Heap bytes per student as vector<Student> against the same rows packed
+// into a StudentStore.
+void print_memory_report(const vector<Student> &students) {
+    StudentStore store;
+    store.build_from(students);
+    auto u = store.memory_usage();
+    double n = (double)students.size();
+    double before = StudentStore::heap_bytes(students) / n, after = u.total() / n;
+    stringstream ss;
+    ss << fixed << setprecision(1) << "Memory per student: " << before << " B as Student, " << after
+       << " B packed (" << before / after << "x smaller; columns " << u.columns / n << ", text " << u.text / n
+       << ", courses " << u.courses / n << ", dictionary " << u.dictionary / n << ")\n";
+    cout << ss.str();
+}
+
+// Non-interactive mode: answer every query in query_file and exit.
+int run_batch(Session& db, const string &query_file, const string &out_file, unsigned threads) {
+    ifstream qin(query_file);
+    if (!qin) { cerr << "Error: cannot read " << query_file << "\n"; return 1; }
+    ofstream fout;
+    if (!out_file.empty()) {
+        fout.open(out_file, ios::trunc);
+        if (!fout) { cerr << "Error: cannot write " << out_file << "\n"; return 1; }
+    }
+    size_t n = load_dataset(db);
+    db.cidx.build_from(db.students);
+    auto bs = ERPUtils::run_batch_queries(db.cidx, db.students, qin, out_file.empty() ? cout : fout, threads);
+    cerr << "batch: " << n << " records, " << bs.queries << " queries (" << bs.rejected << " skipped), "
+         << bs.results << " rows in " << bs.duration_us / 1000.0 << " ms\n";
+    return 0;
+}
+
+// Non-interactive mode: best K of each course straight from the CSV, without loading it;
+// the journal is applied on top. spec is COURSE[,COURSE...]:K.
+int run_top(const string &csv_file, const string &spec, unsigned threads) {
+    auto colon = spec.rfind(':');
+    int k = colon == string::npos ? 0 : atoi(spec.c_str() + colon + 1);
+    if (k <= 0) { cerr << "Error: --top expects COURSE[,COURSE...]:K\n"; return 1; }
+    vector<CourseID> courses;
+    stringstream ss(spec.substr(0, colon));
+    string c;
+    while (getline(ss, c, ',')) if (!(c = InputValidator::trim(c)).empty()) courses.push_back(ERPUtils::parse_course_id(c));
+    unordered_set<string> dropped;
+    vector<Student> added;
+    Journal::changes(csv_file, dropped, added);
+    auto res = TopK::top_k_csv(csv_file, courses, k, threads, dropped, added);
+    cout << "course,rank,roll,name,grade\n";
+    for (size_t i = 0; i < courses.size(); ++i)
+        for (size_t r = 0; r < res[i].size(); ++r)
+            cout << to_string_variant(courses[i]) << "," << (r + 1) << "," << to_string_variant(res[i][r].student.get_roll()) << ","
+                 << res[i][r].student.get_name() << "," << res[i][r].grade << "\n";
+    return 0;
+}
+
+static QueryServer *running_server = nullptr;
+
+// Server mode: load and index once, then answer clients until SIGINT/SIGTERM.
+int run_server(Session& db, const QueryServer::Options &opt) {
+    LoadStats ls;
+    size_t n = load_dataset(db, &ls);
+    string issues = ls.issues.summary();
+    if (!issues.empty()) cerr << "malformed rows: " << issues << "\n";
+    Dataset data;
+    data.reset(move(db.students));
+    QueryServer server(data, db.journal, opt);
+    if (!server.start()) return 1;
+    running_server = &server;
+    signal(SIGINT, [](int) { running_server->stop(); });
+    signal(SIGTERM, [](int) { running_server->stop(); });
+    cerr << "serving " << n << " records on " << (opt.port ? "127.0.0.1:" + to_string(opt.port) : opt.socket_path) << "\n";
+    server.run();
+    // A second Ctrl-C during the compaction below simply ends the process
+    // (compaction is crash-safe); the handlers must not outlive the server.
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    running_server = nullptr;
+    db.journal.compact_async();
+    db.journal.wait();
+    cerr << "server stopped\n";
+    return 0;
+}
+
+// Usage: ./erp [students.csv] [--batch QUERIES [--out FILE] [--threads N]] [--top COURSE[,COURSE...]:K]
+//              [--serve SOCKET | --port N] [--metrics[=json]]
+// --metrics prints a text metrics snapshot to stderr on exit, --metrics=json a JSON one.
+int main(int argc, char** argv) {
+    string metrics_format, csv_file = "students.csv", batch_file, out_file, top_spec;
+    QueryServer::Options serve;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--metrics") metrics_format = "text";
+        else if (a.rfind("--metrics=", 0) == 0) metrics_format = a.substr(10);
+        else if (a == "--batch" && i + 1 < argc) batch_file = argv[++i];
+        else if (a == "--out" && i + 1 < argc) out_file = argv[++i];
+        else if (a == "--top" && i + 1 < argc) top_spec = argv[++i];
+        else if (a == "--serve" && i + 1 < argc) serve.socket_path = argv[++i];
+        else if (a == "--port" && i + 1 < argc) serve.port = atoi(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threads = (unsigned)max(0, atoi(argv[++i]));
+        else if (!a.empty() && a[0] != '-') csv_file = a;
+        else {
+            cerr << "Usage: " << argv[0] << " [students.csv] [--batch QUERIES [--out FILE] [--threads N]] [--top COURSE[,COURSE...]:K] [--serve SOCKET | --port N] [--metrics[=json]]\n";
+            return 1;
+        }
+    }
+
+    if (!top_spec.empty()) {
+        int rc = run_top(csv_file, top_spec, threads);
+        print_metrics(metrics_format);
+        return rc;
+    }
+    Session db(csv_file);
+    if (!batch_file.empty()) {
+        int rc = run_batch(db, batch_file, out_file, threads);
+        print_metrics(metrics_format);
+        return rc;
+    }
+    if (!serve.socket_path.empty() || serve.port) {
+        serve.threads = threads;
+        int rc = run_server(db, serve);
+        print_metrics(metrics_format);
+        return rc;
+    }
+    auto& students = db.students;
+    auto& sorted_indices = db.sorted_indices;
+    auto& input_order = db.input_order;
+    auto& cidx = db.cidx;
 
     while (true) {
         displayMenu();
-        int choice = InputValidator::readMenuChoice(0, 11);
-        if (choice == 0) break;
+        int choice = InputValidator::readMenuChoice(0, 18);
+        if (choice == 0) {
+            db.journal.compact_async();
+            db.journal.wait();
+            break;
+        }
 
         switch (choice) {
-            case 1: manual_add_student(students, true); break;
-            case 2: manual_add_student(students, false); break;
+            case 1: manual_add_student(db, true); break;
+            case 2: manual_add_student(db, false); break;
             case 3: {
-                if (students.empty()) ERPUtils::load_csv(csv_file, students);
+                if (students.empty()) load_dataset(db);
                 size_t limit = InputValidator::readDisplayLimit();
                 if (limit == 0) limit = students.size();
                 cout << "Total: " << students.size() << "\n";
@@ -146,22 +395,34 @@ int main() {
                 break;
             }
             case 4: 
-                system("./gen_students 3000"); 
+                system("./gen_students 3000 --by-university"); 
                 wait_for_enter(); 
                 break;
-            case 5: 
-                students.clear(); 
-                cout << "Loaded " << ERPUtils::load_csv(csv_file, students) << " records.\n"; 
-                wait_for_enter(); 
+            case 5: {
+                students.clear();
+                LoadStats ls;
+                size_t n = load_dataset(db, &ls);
+                stringstream ss;
+                ss << fixed << setprecision(1) << "Loaded " << n << " records ("
+                   << ls.bytes / (1024.0 * 1024.0) << " MB in " << ls.duration_us / 1000.0
+                   << " ms, " << ls.mb_per_s() << " MB/s).\n";
+                string issues = ls.issues.summary();
+                if (!issues.empty()) ss << "Malformed rows: " << issues << ".\n";
+                cout << ss.str();
+                wait_for_enter();
                 break;
+            }
             case 6: {
                 if (students.empty()) { cout << "Load first.\n"; wait_for_enter(); break; }
                 sorted_indices.resize(students.size());
                 iota(sorted_indices.begin(), sorted_indices.end(), 0);
-                ThreadTimer t1, t2;
-                ERPUtils::parallel_sort_indices(sorted_indices, students, t1, t2);
-                cout << "T1: " << t1.duration_ms << "ms, T2: " << t2.duration_ms << "ms\n";
-                sorted = true;
+                SortTimings st;
+                ERPUtils::parallel_sort_indices(sorted_indices, students, st);
+                cout << "Sorted " << students.size() << " records on " << st.thread_ms.size() << " threads in "
+                     << st.total_ms << "ms (sort " << st.sort_ms << "ms, merge " << st.merge_ms << "ms)\n";
+                for (size_t t = 0; t < st.thread_ms.size(); ++t)
+                    cout << "T" << (t + 1) << ": " << st.thread_ms[t] << "ms" << (t + 1 < st.thread_ms.size() ? ", " : "\n");
+                db.sorted = true;
                 wait_for_enter();
                 break;
             }
@@ -177,7 +438,7 @@ int main() {
                 break;
             }
             case 8: {
-                if (!sorted) { cout << "Sort first.\n"; wait_for_enter(); break; }
+                if (!db.sorted) { cout << "Sort first.\n"; wait_for_enter(); break; }
                 size_t limit = InputValidator::readDisplayLimit();
                 if (limit==0) limit = sorted_indices.size();
                 for(size_t i=0; i<sorted_indices.size() && i<limit; ++i)
@@ -188,7 +449,7 @@ int main() {
             case 9: // Fallthrough to 10 logic for simplicity or keep distinct
             case 10: {
                 if (students.empty()) { cout << "Load data first.\n"; wait_for_enter(); break; }
-                if (!indexed) { cidx.build_from(students); indexed = true; }
+                if (!db.indexed) { cidx.build_from(students); db.indexed = true; }
                 
                 if (choice == 10) {
                      cout << "--- Available Courses ---\n";
@@ -209,15 +470,135 @@ int main() {
                 if(limit==0) limit = res.size();
                 cout << "Found " << res.size() << " students.\n";
                 for(size_t i=0; i<res.size() && i<limit; ++i)
-                    cout << res[i]->brief() << " [" << *(res[i]->grade_for_course(cid)) << "]\n";
+                    cout << students[res[i].student].brief() << " [" << res[i].grade << "]\n";
                 wait_for_enter();
                 break;
             }
             case 11: 
-                delete_student(students); 
-                sorted = false; indexed = false; 
+                delete_student(db); 
+                break;
+            case 12:
+                cout << Metrics::snapshot().to_text();
+                if (!students.empty()) print_memory_report(students);
+                wait_for_enter();
+                break;
+            case 13: {
+                if (students.empty()) { cout << "Load data first.\n"; wait_for_enter(); break; }
+                if (!db.indexed) { cidx.build_from(students); db.indexed = true; }
+                cout << "e.g. CS101>=8 AND 201>=8 AND NOT MATH102   or   (ML201=8..9.5 OR ML301>9)\n";
+                string text = InputValidator::readString("Query: ");
+                QueryExpr q;
+                string err;
+                if (!QueryExpr::parse(text, q, &err)) { cout << "Invalid query: " << err << "\n"; wait_for_enter(); break; }
+                auto res = QueryEngine(cidx).evaluate(q);
+                size_t limit = InputValidator::readDisplayLimit();
+                if (limit == 0) limit = res.size();
+                cout << "Found " << res.size() << " students.\n";
+                for (size_t i = 0; i < res.size() && i < limit; ++i)
+                    cout << students[res[i]].brief() << "\n";
+                wait_for_enter();
+                break;
+            }
+            case 14: {
+                if (students.empty()) { cout << "Load data first.\n"; wait_for_enter(); break; }
+                if (!db.indexed) { cidx.build_from(students); db.indexed = true; }
+                cout << "Group by: 0 = none, 1 = branch, 2 = start year\n";
+                int g = InputValidator::readMenuChoice(0, 2);
+                auto stats = Analytics::course_stats(cidx, students, g == 1 ? GroupBy::Branch : g == 2 ? GroupBy::StartYear : GroupBy::None);
+                cout << Analytics::to_text(stats);
+                string c_in = InputValidator::readString("Histogram for course (- to skip): ");
+                for (auto &s : stats)
+                    if (CourseDict::name(s.course) == c_in) cout << Analytics::histogram_text(s);
+                wait_for_enter();
                 break;
+            }
+            case 15: {
+                if (students.empty()) load_dataset(db);
+                ensure_ranks(db);
+                cout << "1 = rank of a student, 2 = top K of a branch and start year\n";
+                if (InputValidator::readMenuChoice(1, 2) == 1) {
+                    ensure_roll_index(db);
+                    auto found = db.ridx.find_by_text(InputValidator::readString("Enter Roll Number: "));
+                    if (!found) { cout << "Not found.\n"; wait_for_enter(); break; }
+                    const Student &s = students[*found];
+                    auto rank = db.ranks.rank_of(*found);
+                    if (!rank) { cout << s.brief() << " has no courses.\n"; wait_for_enter(); break; }
+                    cout << fixed << setprecision(2) << s.brief() << ": CGPA " << *db.ranks.cgpa(*found) << ", rank " << *rank
+                         << " of " << db.ranks.group_size(s.get_branch(), s.get_startYear()) << "\n";
+                    cout.unsetf(ios::fixed);
+                } else {
+                    string branch = InputValidator::readString("Branch: ");
+                    int year = InputValidator::readYear("Start Year (YYYY): ");
+                    int k = InputValidator::readInt("K: ");
+                    auto top = db.ranks.top_k(branch, year, k > 0 ? k : 0);
+                    cout << "Top " << top.size() << " of " << db.ranks.group_size(branch, year) << " in " << branch << " " << year << ":\n";
+                    for (size_t i = 0; i < top.size(); ++i)
+                        cout << fixed << setprecision(2) << (i + 1) << ". " << students[top[i]].brief() << "  CGPA " << *db.ranks.cgpa(top[i]) << "\n";
+                    cout.unsetf(ios::fixed);
+                }
+                wait_for_enter();
+                break;
+            }
+            case 16: {
+                if (students.empty()) { cout << "Load data first.\n"; wait_for_enter(); break; }
+                CourseID cid = ERPUtils::parse_course_id(InputValidator::readString("Enter Course ID: "));
+                int k = InputValidator::readInt("K: ");
+                // A built index already holds the sorted list; otherwise keep only the best K.
+                vector<Posting> top;
+                if (db.indexed) {
+                    auto [first, last] = cidx.grade_range(cid, 0.0, 10.0);
+                    if (first) top.assign(first, first + min<size_t>(last - first, k > 0 ? k : 0));
+                } else {
+                    top = TopK::top_k(students, {cid}, k > 0 ? k : 0)[0];
+                }
+                cout << "Top " << top.size() << " in " << to_string_variant(cid) << ":\n";
+                for (size_t i = 0; i < top.size(); ++i)
+                    cout << (i + 1) << ". " << students[top[i].student].brief() << " [" << top[i].grade << "]\n";
+                wait_for_enter();
+                break;
+            }
+            case 17: {
+                if (students.empty()) load_dataset(db);
+                ensure_name_index(db);
+                string q = InputValidator::readString("Name (or part of it): ");
+                size_t limit = InputValidator::readDisplayLimit();
+                auto res = db.nidx.search(q, limit);
+                cout << "Found " << res.size() << " students.\n";
+                for (size_t i = 0; i < res.size(); ++i)
+                    cout << (i + 1) << ". " << students[res[i]].brief() << "\n";
+                wait_for_enter();
+                break;
+            }
+            case 18: {
+                UniversityStores &us = ensure_universities(db);
+                cout << "IIIT-Delhi: " << us.iiit.size() << ", IIT-Delhi: " << us.iit.size()
+                     << ", mixed: " << us.mixed.size() << "\n";
+                string c_in = InputValidator::readString("Course code (- to list by name): ");
+                size_t limit = InputValidator::readDisplayLimit();
+                auto show = [&](size_t i, const UniversityStores::Ref &r) {
+                    auto &src = us.source(r.store);
+                    cout << (i + 1) << ". [" << src.label() << "] " << src.brief(r.index);
+                };
+                if (c_in == "-") {
+                    ThreadPool pool(max(1u, thread::hardware_concurrency()) - 1);
+                    auto order = us.sorted(pool);
+                    if (limit == 0) limit = order.size();
+                    for (size_t i = 0; i < order.size() && i < limit; ++i) { show(i, order[i]); cout << "\n"; }
+                } else {
+                    double g = InputValidator::readDouble("Min Grade: ");
+                    auto res = us.top_for_course(ERPUtils::parse_course_id(c_in), g);
+                    cout << "Found " << res.size() << " students.\n";
+                    if (limit == 0) limit = res.size();
+                    for (size_t i = 0; i < res.size() && i < limit; ++i) {
+                        show(i, res[i].first);
+                        cout << " - " << fixed << setprecision(1) << res[i].second << "\n";
+                    }
+                }
+                wait_for_enter();
+                break;
+            }
         }
     }
+    print_metrics(metrics_format);
     return 0;
-}
\ No newline at end of file
+}